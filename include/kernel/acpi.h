@@ -0,0 +1,150 @@
+#ifndef ACPI_H
+#define ACPI_H 1
+
+#include <types.h>
+#include <utils.h>
+
+#include <libk/multiboot2.h>
+
+/**
+ * @name acpi_rsdp_t
+ *
+ * 根系统描述指针。ACPI 1.0中只有到`rsdt_address`为止的部分，`revision`为0。
+ */
+typedef struct __acpi_rsdp_t
+{
+    char signature[8];
+    u8 checksum;
+    char oem_id[6];
+    u8 revision;
+    u32 rsdt_address;
+    u32 length;
+    u64 xsdt_address;
+    u8 extended_checksum;
+    u8 reserved[3];
+} DISALIGNED acpi_rsdp_t;
+
+/**
+ * @name acpi_sdt_header_t
+ *
+ * 所有系统描述表共同的表头，`length`包括表头在内。
+ */
+typedef struct __acpi_sdt_header_t
+{
+    char signature[4];
+    u32 length;
+    u8 revision;
+    u8 checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    u32 oem_revision;
+    u32 creator_id;
+    u32 creator_revision;
+} DISALIGNED acpi_sdt_header_t;
+
+/**
+ * @name acpi_srat_t
+ *
+ * 系统资源亲和性表，表头之后是一系列以`type`与`length`开头的结构。
+ */
+typedef struct __acpi_srat_t
+{
+    acpi_sdt_header_t header;
+    u32 reserved1;
+    u64 reserved2;
+    u8 entries[0];
+} DISALIGNED acpi_srat_t;
+
+/**
+ * @name ACPI_SRAT_xx
+ *
+ * SRAT中的结构类型与标志位。
+ *
+ * * `ACPI_SRAT_PROCESSOR`：处理器本地APIC亲和性结构`acpi_srat_processor_t`
+ * * `ACPI_SRAT_MEMORY`：内存亲和性结构`acpi_srat_memory_t`
+ * * `ACPI_SRAT_X2APIC`：处理器本地x2APIC亲和性结构`acpi_srat_x2apic_t`
+ * * `ACPI_SRAT_ENABLED`：结构有效，没有设置时应忽略这个结构
+ */
+#define ACPI_SRAT_PROCESSOR 0
+#define ACPI_SRAT_MEMORY 1
+#define ACPI_SRAT_X2APIC 2
+#define ACPI_SRAT_ENABLED ((u32)1)
+
+typedef struct __acpi_srat_processor_t
+{
+    u8 type;
+    u8 length;
+    u8 domain_low;
+    u8 apic_id;
+    u32 flags;
+    u8 sapic_eid;
+    u8 domain_high[3];
+    u32 clock_domain;
+} DISALIGNED acpi_srat_processor_t;
+
+typedef struct __acpi_srat_memory_t
+{
+    u8 type;
+    u8 length;
+    u32 domain;
+    u16 reserved1;
+    u64 base;
+    u64 size;
+    u32 reserved2;
+    u32 flags;
+    u64 reserved3;
+} DISALIGNED acpi_srat_memory_t;
+
+typedef struct __acpi_srat_x2apic_t
+{
+    u8 type;
+    u8 length;
+    u16 reserved1;
+    u32 domain;
+    u32 x2apic_id;
+    u32 flags;
+    u32 clock_domain;
+    u32 reserved2;
+} DISALIGNED acpi_srat_x2apic_t;
+
+/**
+ * @name acpi_slit_t
+ *
+ * 系统局部性距离信息表。`distance`是`locality_amount * locality_amount`的矩阵，
+ * 第`i`行第`j`列是邻近域`i`到邻近域`j`的相对距离，到自身的距离为10。
+ */
+typedef struct __acpi_slit_t
+{
+    acpi_sdt_header_t header;
+    u64 locality_amount;
+    u8 distance[0];
+} DISALIGNED acpi_slit_t;
+
+/**
+ * @name acpi_init
+ *
+ * ```c
+ * void acpi_init(bootinfo_t *bootinfo);
+ * ```
+ *
+ * 从bootinfo的ACPI RSDP标签中取得RSDT或XSDT的物理地址，两种标签都存在时使用XSDT。
+ *
+ * 只记录地址，不访问任何表，可以在直接映射建立之前调用。
+ */
+void acpi_init(bootinfo_t *bootinfo);
+
+/**
+ * @name acpi_find_table
+ *
+ * ```c
+ * acpi_sdt_header_t *acpi_find_table(const char *signature);
+ * ```
+ *
+ * 查找签名为`signature`（4个字符）且校验和正确的第一个系统描述表，返回它在直接映射中的地址。
+ *
+ * 表可能位于没有被直接映射的保留内存中，查找时会把访问到的表映射到直接映射区域中它的位置。
+ * 需要在`memm_frame_init`建立直接映射之后调用，没有找到时返回`nullptr`。
+ */
+acpi_sdt_header_t *acpi_find_table(const char *signature);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef X86_64_FPU_H
+#define X86_64_FPU_H 1
+
+#include <types.h>
+
+/**
+ * @name KERNEL_FPU_LEVELS
+ * @addindex 平台定制宏 x86_64
+ *
+ * 每个处理器的保存区数量，即可以使用FPU的中断嵌套层数。第0层是没有处于中断中的上下文。
+ * 更深的中断中`kernel_fpu_begin`返回false。
+ */
+#define KERNEL_FPU_LEVELS 4
+
+/**
+ * @name KERNEL_XCR0_xx
+ * @addindex 平台依赖结构 x86_64
+ *
+ * XCR0中的状态分量。
+ *
+ * * `KERNEL_XCR0_X87`、`KERNEL_XCR0_SSE`：x87与SSE状态，开启XSAVE时总是开启。
+ * * `KERNEL_XCR0_AVX`：ymm寄存器的高128位。
+ * * `KERNEL_XCR0_AVX512`：opmask、zmm寄存器的高256位与zmm16~zmm31，三个分量必须一起开启。
+ */
+#define KERNEL_XCR0_X87 ((u64)1 << 0)
+#define KERNEL_XCR0_SSE ((u64)1 << 1)
+#define KERNEL_XCR0_AVX ((u64)1 << 2)
+#define KERNEL_XCR0_AVX512 ((u64)7 << 5)
+
+/**
+ * @name KERNEL_CR0_xx, KERNEL_CR4_xx
+ * @addindex 平台依赖结构 x86_64
+ *
+ * 开启FPU与向量寄存器使用的控制位。
+ */
+#define KERNEL_CR0_MP ((u64)1 << 1)
+#define KERNEL_CR0_EM ((u64)1 << 2)
+#define KERNEL_CR0_TS ((u64)1 << 3)
+#define KERNEL_CR4_OSFXSR ((u64)1 << 9)
+#define KERNEL_CR4_OSXMMEXCPT ((u64)1 << 10)
+#define KERNEL_CR4_OSXSAVE ((u64)1 << 18)
+
+/**
+ * @name kernel_fpu_t
+ * @addindex 平台依赖结构 x86_64
+ *
+ * 每个处理器的FPU状态。
+ *
+ * @internal level
+ *
+ * 当前的中断嵌套层数，由中断入口程序维护。
+ *
+ * @internal saved
+ *
+ * 第`i`位表示第`i`层第一次使用FPU时已把被打断的上下文的状态保存在第`i`个保存区中，
+ * 中断层在中断返回时恢复，第0层在最外层的`kernel_fpu_end`中恢复。
+ *
+ * @internal nesting
+ *
+ * 每一层中`kernel_fpu_begin`的嵌套数量，第0层降为0时恢复保存的状态。
+ *
+ * @internal area
+ *
+ * `KERNEL_FPU_LEVELS`个连续的保存区，每个`kernel_fpu_size`字节，按64字节对齐。
+ * 为`nullptr`时处理器还没有开启FPU。
+ */
+typedef struct __kernel_fpu_t
+{
+    usize level;
+    usize saved;
+    u32 nesting[KERNEL_FPU_LEVELS];
+    u8 *area;
+} kernel_fpu_t;
+
+/**
+ * @name kernel_xsave, kernel_xsaveopt, kernel_xrstor, kernel_fxsave, kernel_fxrstor
+ * @addindex 平台定制函数 x86_64
+ *
+ * ```c
+ * void kernel_xsave(void *area);
+ * void kernel_xsaveopt(void *area);
+ * void kernel_xrstor(void *area);
+ * void kernel_fxsave(void *area);
+ * void kernel_fxrstor(void *area);
+ * ```
+ *
+ * 保存或恢复XCR0中所有开启的状态分量，不支持XSAVE时只保存或恢复x87与SSE状态。
+ * `area`按64字节对齐，`fxsave`只要求16字节。
+ *
+ * `kernel_xsaveopt`不写入处于初始状态的分量，也不写入自上一次从同一个`area`执行`kernel_xrstor`以来没有改变的分量。
+ * 内核区间中只使用xmm寄存器时，ymm与zmm的高位保持初始状态，每次保存只写入x87与SSE状态。
+ */
+extern void kernel_xsave(void *area);
+extern void kernel_xsaveopt(void *area);
+extern void kernel_xrstor(void *area);
+extern void kernel_fxsave(void *area);
+extern void kernel_fxrstor(void *area);
+
+/**
+ * @name kernel_xsetbv, kernel_fninit
+ * @addindex 平台定制函数 x86_64
+ *
+ * ```c
+ * void kernel_xsetbv(u32 xcr, u64 value);
+ * void kernel_fninit();
+ * ```
+ */
+extern void kernel_xsetbv(u32 xcr, u64 value);
+extern void kernel_fninit();
+
+/**
+ * @name kernel_fpu_interrupt_enter, kernel_fpu_interrupt_leave
+ * @addindex 平台定制函数 x86_64
+ *
+ * ```c
+ * void kernel_fpu_interrupt_enter();
+ * void kernel_fpu_interrupt_leave();
+ * ```
+ *
+ * 由中断入口程序在进入与离开中断时调用，只改变嵌套层数，离开时恢复这一层保存的状态。
+ * 没有使用FPU的中断不保存也不恢复任何状态。
+ */
+void kernel_fpu_interrupt_enter();
+void kernel_fpu_interrupt_leave();
+
+#endif
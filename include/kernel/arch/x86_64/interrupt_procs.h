@@ -78,6 +78,7 @@ typedef void (*interrupt_request)(u64 rip, u64 rsp, u64 errcode);
 #define NMI
 #define BP
 #define OF
+#define PF
 
 interrupt_entry_gen(UNSUPPORTED);
 
@@ -85,5 +86,6 @@ interrupt_entry_gen(DE);  // irq0
 interrupt_entry_gen(NMI); // irq2
 interrupt_entry_gen(BP);  // irq3
 interrupt_entry_gen(OF);  // ira4
+interrupt_entry_gen(PF);  // irq14
 
 #endif
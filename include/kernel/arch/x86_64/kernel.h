@@ -14,4 +14,78 @@ extern void prepare_stack();
 
 extern u32 TSS[26];
 
+/**
+ * @name kernel_cpuid
+ *
+ * ```c
+ * void kernel_cpuid(u32 leaf, u32 subleaf, u32 regs[4]);
+ * ```
+ *
+ * 执行`cpuid`指令，结果按`eax`、`ebx`、`ecx`、`edx`的顺序存入`regs`。
+ */
+extern void kernel_cpuid(u32 leaf, u32 subleaf, u32 regs[4]);
+
+/**
+ * @name kernel_apic_id
+ *
+ * ```c
+ * u32 kernel_apic_id();
+ * ```
+ *
+ * 通过`cpuid`取得当前处理器的初始本地APIC ID。
+ */
+extern u32 kernel_apic_id();
+
+/**
+ * @name kernel_rdtsc
+ *
+ * ```c
+ * u64 kernel_rdtsc();
+ * ```
+ *
+ * 读取时间戳计数器，用于测量短时间的操作耗费的时钟周期。
+ */
+extern u64 kernel_rdtsc();
+
+/**
+ * @name read_cr0, write_cr0, read_cr4, write_cr4
+ *
+ * ```c
+ * u64 read_cr0();
+ * void write_cr0(u64 value);
+ * u64 read_cr4();
+ * void write_cr4(u64 value);
+ * ```
+ */
+extern u64 read_cr0();
+extern void write_cr0(u64 value);
+extern u64 read_cr4();
+extern void write_cr4(u64 value);
+
+/**
+ * @name read_msr, write_msr
+ *
+ * ```c
+ * u64 read_msr(u32 msr);
+ * void write_msr(u32 msr, u64 value);
+ * ```
+ */
+extern u64 read_msr(u32 msr);
+extern void write_msr(u32 msr, u64 value);
+
+/**
+ * @name KERNEL_CR0_WP
+ *
+ * CR0.WP，开启后内核态写入只读页也触发缺页异常，写时复制的页才能防止内核写入。
+ */
+#define KERNEL_CR0_WP ((u64)1 << 16)
+
+/**
+ * @name KERNEL_CR4_xx
+ *
+ * CR4中使用的控制位。
+ */
+#define KERNEL_CR4_PGE ((u64)1 << 7)
+#define KERNEL_CR4_PCIDE ((u64)1 << 17)
+
 #endif
@@ -3,6 +3,7 @@
 
 #include <types.h>
 #include <libk/bits.h>
+#include <libk/itree.h>
 
 /**
  * @details x86_64
@@ -14,7 +15,16 @@
  * * 2MB \~ 4MB：中断栈。
  * * 4MB \~ 16MB：内核栈。
  * * 16MB \~ ?：内核镜像。
- * * ? \~ 128MB：内核大分配器。
+ * * ? \~ ? + 8MB：内核slab分配器。
+ * * ? + 8MB \~ 60MB：内核大分配器。
+ * * 60MB \~ 64MB：页表区域。
+ * * 64MB \~ ：页框分配器。
+ *
+ * 虚拟地址空间：
+ *
+ * * 0 \~ 64MB：与物理地址相同的映射。
+ * * `MEMM_PHYSMAP_BASE`开始：所有物理内存的直接映射。
+ * * `0xffff800000000000`以上：用户空间。
  */
 
 /**
@@ -96,6 +106,18 @@ extern u64 PML4[512];
 #define MEMM_PTE_ENTRY_FLAG_PAT ((u64)1 << 7)
 #define MEMM_ENTRY_FLAG_XD ((u64)1 << 63)
 
+/**
+ * @name MEMM_ENTRY_FLAG_SHARED, MEMM_ENTRY_FLAG_COW
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 使用叶子页表项中由软件使用的第9、10位。
+ *
+ * * `MEMM_ENTRY_FLAG_SHARED`：页框被多个地址空间共享，共享数量记录在页框描述符的`refcount`中，大型页记录在块的首个页框中
+ * * `MEMM_ENTRY_FLAG_COW`：页可以写入，但由于被共享而暂时只读，写入时触发缺页异常复制一份私有的页
+ */
+#define MEMM_ENTRY_FLAG_COW ((u64)1 << 9)
+#define MEMM_ENTRY_FLAG_SHARED ((u64)1 << 10)
+
 /**
  * @name memm_entry_flag_get(entry, flag)
  * @addindex 平台依赖宏 x86_64
@@ -126,11 +148,15 @@ extern u64 PML4[512];
 #define MEMM_BP_ENTRY_ADDRESS_MASK ((u64)0x000fffffffffe000)
 
 /**
- * @name memm_entry_get_address(entry)
+ * @name memm_entry_get_address(entry), memm_pte_get_address(entry)
  * @addindex 平台依赖宏 x86_64
  *
  * 获取页表项指向的地址。
+ *
+ * `memm_entry_get_address`用于PML4E、PDPTE与PDE；pte中没有PS位，它的第7位是PAT位，需要使用`memm_pte_get_address`。
  */
+#define memm_pte_get_address(entry) \
+    ((entry) & MEMM_ENTRY_ADDRESS_MASK)
 #define memm_entry_get_address(entry)                          \
     ((entry) & (memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PS) \
                     ? MEMM_BP_ENTRY_ADDRESS_MASK               \
@@ -193,6 +219,92 @@ extern u64 PML4[512];
 #define memm_la_get_offset(addr, page_type) \
     ((addr) & (page_type##_MASK))
 
+/**
+ * @name MEMM_PHYSMAP_BASE
+ * @addindex 平台定制宏
+ *
+ * 物理内存直接映射的起始地址。
+ *
+ * @if arch == x86_64
+ *  用户空间位于高地址，因此直接映射放在低地址的内核空间中`0x0000400000000000`处，可以容纳`MEMM_MAX_SUPPORTED_MEMORY`。
+ * @endif
+ */
+#define MEMM_PHYSMAP_BASE ((u64)0x0000400000000000)
+
+extern bool memm_physmap_ready;
+
+/**
+ * @name memm_1g_page_supported
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 处理器是否支持1GB页，由`memm_address_space_init`通过`cpuid`检测。不支持时`memm_map_pageframes_to`用2MB页代替。
+ */
+extern bool memm_1g_page_supported;
+
+/**
+ * @name phys_to_virt(physical), virt_to_phys(virtual)
+ * @addindex 平台定制宏
+ *
+ * 物理地址与内核空间地址的转换。
+ *
+ * `phys_to_virt`得到物理内存直接映射中的地址，只对内存映射中的内存有效；直接映射建立之前得到与物理地址相同的地址。
+ *
+ * `virt_to_phys`只对直接映射中的地址与`MEMM_ALLOC_ONLY_MEMORY`以内的地址有效。
+ */
+#define phys_to_virt(physical) \
+    ((void *)((u64)(physical) + (memm_physmap_ready ? MEMM_PHYSMAP_BASE : 0)))
+#define virt_to_phys(virtual)                                               \
+    (((u64)(virtual) >= MEMM_PHYSMAP_BASE &&                                \
+      (u64)(virtual) < MEMM_PHYSMAP_BASE + MEMM_MAX_SUPPORTED_MEMORY)       \
+         ? (u64)(virtual) - MEMM_PHYSMAP_BASE                               \
+         : (u64)(virtual))
+
+/**
+ * @name memm_memory_type
+ * @addindex 平台定制结构
+ *
+ * 映射的内存类型。
+ *
+ * * `MEMM_MEMORY_TYPE_WB`：回写，用于普通内存。
+ * * `MEMM_MEMORY_TYPE_WC`：写合并，用于帧缓冲区等只写的设备内存。
+ * * `MEMM_MEMORY_TYPE_UC`：不可缓存，用于设备寄存器。
+ * * `MEMM_MEMORY_TYPE_WT`：写透。
+ *
+ * @if arch == x86_64
+ *  枚举值为PAT表项的序号，由页表项中的PAT、PCD、PWT三位组成。
+ * @endif
+ */
+typedef enum __memm_memory_type
+{
+    MEMM_MEMORY_TYPE_WB = 0,
+    MEMM_MEMORY_TYPE_WC = 1,
+    MEMM_MEMORY_TYPE_UC = 3,
+    MEMM_MEMORY_TYPE_WT = 7,
+} memm_memory_type;
+
+/**
+ * @name MEMM_MSR_IA32_PAT, MEMM_PAT_VALUE
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 启动时写入IA32_PAT的值。PAT0\~PAT7依次为WB、WC、UC-、UC、WB、WP、UC-、WT，
+ * 前四项中除PAT1外与上电时的默认值相同，因此没有设置PAT位的页表项的内存类型不变。
+ */
+#define MEMM_MSR_IA32_PAT 0x277
+#define MEMM_PAT_VALUE ((u64)0x0407050600070106)
+
+/**
+ * @name memm_memory_type_flags(type, large)
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 内存类型对应的页表项标志位。`large`为true时用于大型页页表项，PAT位位于第12位；否则用于pte，PAT位位于第7位。
+ */
+#define memm_memory_type_flags(type, large)                             \
+    ((((type) & 1) ? MEMM_ENTRY_FLAG_PWT : 0) |                         \
+     (((type) & 2) ? MEMM_ENTRY_FLAG_PCD : 0) |                         \
+     (((type) & 4) ? ((large) ? MEMM_ENTRY_FLAG_PAT                     \
+                              : MEMM_PTE_ENTRY_FLAG_PAT)                \
+                   : 0))
+
 /**
  * @name memm_map_pageframes_to
  *
@@ -200,7 +312,8 @@ extern u64 PML4[512];
  * bool memm_map_pageframes_to(
  *     u64 target, u64 physical,
  *     usize size,
- *     bool user, bool write);
+ *     bool user, bool write,
+ *     memm_memory_type type);
  * ```
  *
  * 仅支持**canonical**型地址
@@ -212,11 +325,394 @@ extern u64 PML4[512];
  * 当剩余长度超过1GB的一半且地址1GB对齐，则会映射一个1GB页；
  * 当剩余长度超过2MB的一半且地址2MB对齐，则会映射一个2MB页；
  * 否则映射4KB页。
+ *
+ * 映射大型页时，原来映射这段地址的下级页表被归还页表页池；在大型页中映射较小的页时，大型页先被拆分为下级页表。
+ *
+ * 映射的内存类型为`type`，同一段物理内存不应以不同的内存类型映射。
+ *
+ * 无法分配页表页时返回false。
  */
 bool memm_map_pageframes_to(
     u64 target, u64 physical,
     usize size,
-    bool user, bool write);
+    bool user, bool write,
+    memm_memory_type type);
+
+/**
+ * @name MEMM_PCID_AMOUNT
+ * @addindex 平台依赖宏 x86_64
+ *
+ * PCID的数量。PCID`0`固定分配给内核地址空间，其余的按最近最少使用的顺序分配给其它地址空间。
+ */
+#define MEMM_PCID_AMOUNT 4096
+
+/**
+ * @name MEMM_CR3_NOFLUSH
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 开启PCID后，写入CR3时设置此位则保留新PCID的TLB项。
+ */
+#define MEMM_CR3_NOFLUSH ((u64)1 << 63)
+
+/**
+ * @name MEMM_INVPCID_xx
+ * @addindex 平台依赖宏 x86_64
+ *
+ * `invpcid`指令的四种类型：单个地址、单个PCID、包括全局页的所有PCID、不包括全局页的所有PCID。
+ */
+#define MEMM_INVPCID_ADDRESS 0
+#define MEMM_INVPCID_CONTEXT 1
+#define MEMM_INVPCID_ALL_GLOBAL 2
+#define MEMM_INVPCID_ALL 3
+
+/**
+ * @name memm_address_space_t
+ * @addindex 平台依赖结构 x86_64
+ *
+ * 地址空间。所有地址空间共享低地址的内核空间部分，内核空间新增的PML4项会同步到所有地址空间。
+ *
+ * @internal pml4
+ *
+ * PML4页表，位于与物理地址相同的内核空间地址。
+ *
+ * @internal pcid
+ *
+ * 分配到的PCID，内核地址空间以外为0表示没有分配。PCID被回收后设为0。
+ *
+ * @internal stale
+ *
+ * 不是当前地址空间时页表被修改且无法通过`invpcid`刷新，切换到此地址空间时需要刷新它的TLB项。
+ *
+ * @internal next
+ *
+ * 所有地址空间的链表，链头为内核地址空间。
+ *
+ * @internal pid
+ *
+ * 使用此地址空间的进程标识符，内核地址空间为0。
+ *
+ * @internal region_pool, regions, heap
+ *
+ * 用户空间的按需映射区域与用户堆中已分配的内存块，节点都从此地址空间自己的节点池中分配。
+ * 用户堆在第一次分配时才保留，之前`heap`的范围为空。
+ */
+typedef struct __memm_address_space_t
+{
+    u64 *pml4;
+    u16 pcid;
+    bool stale;
+    struct __memm_address_space_t *next;
+
+    usize pid;
+    itree_pool_t region_pool;
+    itree_t regions;
+    itree_t heap;
+} memm_address_space_t;
+
+extern memm_address_space_t memm_kernel_address_space;
+
+/**
+ * @name memm_address_space_init
+ *
+ * ```c
+ * void memm_address_space_init();
+ * ```
+ *
+ * 开启全局页，通过`cpuid`检测PCID与`invpcid`的支持并开启CR4.PCIDE。
+ */
+void memm_address_space_init();
+
+/**
+ * @name memm_address_space_new, memm_address_space_destruct
+ *
+ * ```c
+ * bool memm_address_space_new(memm_address_space_t *space);
+ * void memm_address_space_destruct(memm_address_space_t *space);
+ * ```
+ *
+ * 创建一个只包含内核空间的地址空间，并分配新的进程标识符。无法分配页表页时返回false。
+ *
+ * 销毁地址空间时归还用户空间部分的页表页、按需映射区域与它的PCID，共享的页框减少共享数量，最后一个共享者释放页框，匿名页框被释放，其它页框由调用者释放。
+ * 不能销毁当前地址空间与内核地址空间。
+ */
+bool memm_address_space_new(memm_address_space_t *space);
+void memm_address_space_destruct(memm_address_space_t *space);
+
+/**
+ * @name memm_address_space_clone
+ *
+ * ```c
+ * bool memm_address_space_clone(memm_address_space_t *space, memm_address_space_t *source);
+ * ```
+ *
+ * 以写时复制的方式复制`source`的用户空间，创建地址空间`space`，按需映射区域与用户堆也一起复制。
+ *
+ * 只复制页表，由页框分配器管理的页框在两个地址空间之间共享，其中可写的页在两边都改为只读并设置`MEMM_ENTRY_FLAG_COW`，
+ * 写入时由缺页异常处理程序复制。4KB与2MB页按原来的大小共享，1GB页先被拆分为2MB页。
+ * 其它的页框（如设备内存）直接共享。
+ *
+ * 共享的2MB页必须是一个9阶的块。无法分配页表页时返回false，`space`不会被创建。
+ */
+bool memm_address_space_clone(memm_address_space_t *space, memm_address_space_t *source);
+
+/**
+ * @name memm_address_space_switch, memm_current_address_space
+ *
+ * ```c
+ * void memm_address_space_switch(memm_address_space_t *space);
+ * memm_address_space_t *memm_current_address_space();
+ * ```
+ *
+ * 切换到地址空间`space`。开启PCID时，已有PCID的地址空间写入CR3时设置`MEMM_CR3_NOFLUSH`，保留它的TLB项；
+ * 没有PCID的地址空间取得最近最少使用的PCID并刷新这个PCID的TLB项。
+ *
+ * 映射函数操作当前地址空间的页表。
+ */
+void memm_address_space_switch(memm_address_space_t *space);
+memm_address_space_t *memm_current_address_space();
+
+/**
+ * @name memm_unmap_pageframes
+ *
+ * ```c
+ * bool memm_unmap_pageframes(u64 target, usize size);
+ * ```
+ *
+ * 取消`target`开始`size`字节的映射，`target`与`size`需要以MEMM_PAGE_SIZE对齐。
+ *
+ * 只覆盖了大型页的一部分时先把大型页拆分为下级页表。变为空的PT和PDT归还页表页池，用户空间的PDPT也会被归还。
+ * 匿名页框（见`MEMM_FRAME_FLAG_ANONYMOUS`）与最后一个共享者的页框被释放。
+ *
+ * 拆分大型页时无法分配页表页返回false，此时已经处理的部分保持取消映射。
+ */
+bool memm_unmap_pageframes(u64 target, usize size);
+
+/**
+ * @name memm_protect_pageframes
+ *
+ * ```c
+ * bool memm_protect_pageframes(u64 target, usize size, bool write);
+ * ```
+ *
+ * 修改`target`开始`size`字节的已映射页的可写属性，未映射的页被跳过。对齐要求与返回值同`memm_unmap_pageframes`。
+ */
+bool memm_protect_pageframes(u64 target, usize size, bool write);
+
+/**
+ * @name memm_space_unmap_pageframes, memm_space_protect_pageframes
+ *
+ * ```c
+ * bool memm_space_unmap_pageframes(memm_address_space_t *space, u64 target, usize size);
+ * bool memm_space_protect_pageframes(memm_address_space_t *space, u64 target, usize size, bool write);
+ * ```
+ *
+ * 与`memm_unmap_pageframes`、`memm_protect_pageframes`相同，但操作地址空间`space`的页表，`space`可以不是当前地址空间。
+ */
+bool memm_space_unmap_pageframes(memm_address_space_t *space, u64 target, usize size);
+bool memm_space_protect_pageframes(memm_address_space_t *space, u64 target, usize size, bool write);
+
+/**
+ * @name memm_translation_t
+ * @addindex 平台定制结构
+ *
+ * 虚拟地址的翻译结果。
+ *
+ * * `physical`：虚拟地址对应的物理地址。
+ * * `flags`：映射它的叶子页表项中地址域以外的位，不包括由处理器设置的访问位与脏位。
+ * * `size`：映射它的页的大小。
+ */
+typedef struct __memm_translation_t
+{
+    u64 physical;
+    u64 flags;
+    memm_page_size size;
+} memm_translation_t;
+
+/**
+ * @name MEMM_TRANSLATION_CACHE_SIZE
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 每个处理器的翻译缓存的项数，必须是2的幂。
+ *
+ * 缓存是直接映射的，以`4KB`、`2MB`、`1GB`三种粒度的页号分别计算位置，
+ * 查找时依次检查三个位置，因此大型页中的所有地址共用一项。
+ */
+#define MEMM_TRANSLATION_CACHE_SIZE 64
+
+/**
+ * @name memm_translate, memm_space_translate
+ *
+ * ```c
+ * bool memm_translate(u64 address, memm_translation_t *translation);
+ * bool memm_space_translate(memm_address_space_t *space, u64 address, memm_translation_t *translation);
+ * ```
+ *
+ * 查询`address`的映射，写入`translation`并返回true；地址没有映射时返回false。
+ * `memm_translate`查询当前地址空间，内核空间的地址总是通过当前地址空间查询。
+ *
+ * 查询先检查当前处理器的翻译缓存，未命中时遍历页表并把结果放入缓存。
+ * 缓存只保存存在的映射，在`memm_tlb_batch_flush`中与TLB一起失效，因此所有取消映射、修改映射或降低权限的路径都会使缓存失效；
+ * 新增映射不需要刷新TLB，也不会使缓存失效。
+ */
+bool memm_translate(u64 address, memm_translation_t *translation);
+bool memm_space_translate(memm_address_space_t *space, u64 address, memm_translation_t *translation);
+
+/**
+ * @name memm_sg_entry_t
+ * @addindex 平台定制结构
+ *
+ * 分散/聚集列表中的一项，表示物理地址连续的一段内存。
+ */
+typedef struct __memm_sg_entry_t
+{
+    u64 physical;
+    usize size;
+} memm_sg_entry_t;
+
+/**
+ * @name memm_translate_range
+ *
+ * ```c
+ * usize memm_translate_range(
+ *     memm_address_space_t *space,
+ *     u64 address, usize size,
+ *     memm_sg_entry_t *list, usize capacity, usize *amount);
+ * ```
+ *
+ * 在一次页表遍历中翻译`space`中`address`开始`size`字节的范围，按地址顺序写入分散/聚集列表`list`，
+ * 物理地址连续的部分合并为一项。`address`与`size`不需要对齐，`*amount`为写入的项数。
+ *
+ * 返回已翻译的字节数，遇到没有映射的页或`list`中的`capacity`项用完时提前停止，
+ * 调用者可以从`address`加上返回值处继续。范围不合法时返回0。不使用也不填充翻译缓存。
+ */
+usize memm_translate_range(
+    memm_address_space_t *space,
+    u64 address, usize size,
+    memm_sg_entry_t *list, usize capacity, usize *amount);
+
+/**
+ * @name memm_page_state
+ * @addindex 平台定制结构
+ *
+ * `memm_page_age`检查的结果。
+ *
+ * * `MEMM_PAGE_STATE_GONE`：地址不再以私有的4KB页映射到这个页框。
+ * * `MEMM_PAGE_STATE_REFERENCED`：页在上次检查后被访问过，访问位已被清除。
+ * * `MEMM_PAGE_STATE_IDLE`：页在上次检查后没有被访问。
+ * * `MEMM_PAGE_STATE_DIRTY`：页没有被访问，但曾被写入，不能直接丢弃。
+ * * `MEMM_PAGE_STATE_RECLAIMED`：页没有被访问也没有被写入，已取消映射。
+ */
+typedef enum __memm_page_state
+{
+    MEMM_PAGE_STATE_GONE,
+    MEMM_PAGE_STATE_REFERENCED,
+    MEMM_PAGE_STATE_IDLE,
+    MEMM_PAGE_STATE_DIRTY,
+    MEMM_PAGE_STATE_RECLAIMED,
+} memm_page_state;
+
+/**
+ * @name memm_page_age
+ *
+ * ```c
+ * memm_page_state memm_page_age(memm_address_space_t *space, u64 address, u64 physical, bool reclaim);
+ * ```
+ *
+ * 检查地址空间`space`中`address`处映射到`physical`的页的访问位与脏位，用于页回收。
+ *
+ * 访问位被设置时清除它并返回`MEMM_PAGE_STATE_REFERENCED`。清除访问位时不刷新TLB，TLB中的旧页表项可能使之后的访问不被记录，这只影响回收的准确性：被回收的页总是没有被写入过的。
+ * `reclaim`为true且页没有被访问也没有被写入时取消映射，由调用者释放页框。
+ *
+ * @if arch == x86_64
+ *  内核空间被所有地址空间共享，其中的页通过当前地址空间的页表检查。
+ * @endif
+ */
+memm_page_state memm_page_age(memm_address_space_t *space, u64 address, u64 physical, bool reclaim);
+
+/**
+ * @name MEMM_ENTRY_FLAG_SWAP, memm_swap_entry_make(pte, entry), memm_swap_entry_get(pte)
+ * @addindex 平台定制宏
+ *
+ * 被换出到压缩内存的页的pte不存在，其中保存压缩内存中的项。
+ *
+ * @if arch == x86_64
+ *  不存在的页表项中除存在位以外的位都由软件使用。第11位为`MEMM_ENTRY_FLAG_SWAP`，项的地址保存在第12位以上，
+ *  原来的页表项的属性标志位（除存在位、访问位与脏位）保留，换入时恢复。
+ * @endif
+ */
+#define MEMM_ENTRY_FLAG_SWAP ((u64)1 << 11)
+#define memm_swap_entry_make(pte, entry)                            \
+    (((u64)(entry) << 12) |                                         \
+     ((pte) & (MEMM_PAGE_TABLE_FLAGS_MASK &                         \
+               ~(MEMM_ENTRY_FLAG_PRESENT | MEMM_ENTRY_FLAG_ACCECED | \
+                 MEMM_ENTRY_FLAG_DIRTY))) |                         \
+     MEMM_ENTRY_FLAG_SWAP)
+#define memm_swap_entry_get(pte) \
+    ((void *)(((pte) >> 12) & (((u64)1 << 51) - 1)))
+
+/**
+ * @name memm_page_isolate, memm_page_install
+ *
+ * ```c
+ * u64 memm_page_isolate(memm_address_space_t *space, u64 address, u64 physical);
+ * void memm_page_install(memm_address_space_t *space, u64 address, u64 pte);
+ * ```
+ *
+ * `memm_page_isolate`在页没有被访问时取消`address`到`physical`的映射并刷新TLB，返回原来的pte；
+ * 页已被访问或不再映射到这个页框时返回0。
+ *
+ * `memm_page_install`把被隔离的页的pte写回，可以是原来的pte或换出后的pte。
+ */
+u64 memm_page_isolate(memm_address_space_t *space, u64 address, u64 physical);
+void memm_page_install(memm_address_space_t *space, u64 address, u64 pte);
+
+/**
+ * @name MEMM_TLB_FLUSH_THRESHOLD
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 一次操作中需要逐页刷新的TLB项超过此数量时，改为刷新整个TLB。
+ */
+#define MEMM_TLB_FLUSH_THRESHOLD 32
+
+/**
+ * @name memm_tlb_batch_t
+ * @addindex 平台依赖结构 x86_64
+ *
+ * TLB刷新批次。修改页表时把需要刷新的地址记录在批次中，修改完成后通过`memm_tlb_batch_flush`一起刷新。
+ *
+ * @internal space
+ *
+ * 被修改的地址空间。不是当前地址空间时通过`invpcid`刷新它的PCID，不支持`invpcid`时标记为`stale`。
+ *
+ * @internal flush_all
+ *
+ * 记录的地址超过`MEMM_TLB_FLUSH_THRESHOLD`，需要刷新整个TLB。
+ */
+typedef struct __memm_tlb_batch_t
+{
+    memm_address_space_t *space;
+    u64 address[MEMM_TLB_FLUSH_THRESHOLD];
+    usize amount;
+    bool flush_all;
+} memm_tlb_batch_t;
+
+/**
+ * @name memm_tlb_batch_add, memm_tlb_batch_flush
+ *
+ * ```c
+ * void memm_tlb_batch_add(memm_tlb_batch_t *batch, u64 address, usize size);
+ * void memm_tlb_batch_flush(memm_tlb_batch_t *batch);
+ * ```
+ *
+ * 记录`address`开始`size`字节需要刷新。`size`按4KB页计算需要的`invlpg`次数，
+ * 只映射了一个大型页的地址只需要记录`MEMM_PAGE_SIZE`字节。
+ *
+ * 刷新时逐页执行`invlpg`，或刷新整个TLB。`invlpg`同时使页表结构缓存失效，因此刷新后调用`memm_pagetable_flushed`。
+ * 开启PCID时其它PCID的页表结构缓存可能仍引用被归还的页表页，此时刷新所有PCID。
+ * 刷新后批次被清空，可以继续使用。
+ */
+void memm_tlb_batch_add(memm_tlb_batch_t *batch, u64 address, usize size);
+void memm_tlb_batch_flush(memm_tlb_batch_t *batch);
 
 /**
  * @name reload_pml4
@@ -225,9 +721,86 @@ bool memm_map_pageframes_to(
  * ```c
  * void reload_pml4();
  * ```
+ *
+ * 重新加载CR3，刷新除全局页以外的TLB。
  */
 extern void reload_pml4();
 
+/**
+ * @name invalidate_page, flush_tlb
+ * @addindex 平台依赖宏 x86_64
+ *
+ * ```c
+ * void invalidate_page(u64 address);
+ * void flush_tlb();
+ * ```
+ *
+ * `invalidate_page`使`address`所在页的TLB项失效；`flush_tlb`刷新包括全局页在内的整个TLB。
+ */
+extern void invalidate_page(u64 address);
+extern void flush_tlb();
+
+/**
+ * @name write_cr3, invpcid
+ * @addindex 平台依赖宏 x86_64
+ *
+ * ```c
+ * void write_cr3(u64 value);
+ * void invpcid(u64 type, u64 pcid, u64 address);
+ * ```
+ *
+ * `invpcid`的`type`为`MEMM_INVPCID_xx`。
+ */
+extern void write_cr3(u64 value);
+extern void invpcid(u64 type, u64 pcid, u64 address);
+
+/**
+ * @name clear_page_nontemporal
+ * @addindex 平台依赖宏 x86_64
+ *
+ * ```c
+ * void clear_page_nontemporal(void *page);
+ * ```
+ *
+ * 用非临时存储（`movnti`）清零`page`开始的一页，不经过缓存，返回前执行`sfence`。
+ * 用于清零不会马上被访问的页。
+ */
+extern void clear_page_nontemporal(void *page);
+
+/**
+ * @name MEMM_PF_ERROR_xx
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 缺页异常错误码的位。
+ *
+ * * `MEMM_PF_ERROR_PRESENT`：由权限检查失败引起，否则由页不存在引起
+ * * `MEMM_PF_ERROR_WRITE`：由写访问引起
+ * * `MEMM_PF_ERROR_USER`：由用户态访问引起
+ * * `MEMM_PF_ERROR_RESERVED`：页表项中设置了保留位
+ * * `MEMM_PF_ERROR_FETCH`：由取指令引起
+ */
+#define MEMM_PF_ERROR_PRESENT ((u64)1)
+#define MEMM_PF_ERROR_WRITE ((u64)1 << 1)
+#define MEMM_PF_ERROR_USER ((u64)1 << 2)
+#define MEMM_PF_ERROR_RESERVED ((u64)1 << 3)
+#define MEMM_PF_ERROR_FETCH ((u64)1 << 4)
+
+/**
+ * @name memm_handle_page_fault
+ * @addindex 平台依赖函数 x86_64
+ *
+ * ```c
+ * bool memm_handle_page_fault(u64 address, u64 errcode);
+ * ```
+ *
+ * 缺页异常处理程序，`address`为CR2中的地址，`errcode`为异常的错误码。
+ *
+ * 处理不存在的页，被换出的页从压缩内存中换入，其它的由`memm_lazy_populate`映射；
+ * 以及对写时复制页的写入，页框仍被共享时复制一份私有的页，否则直接改为可写。
+ * 返回false表示这是一个无法处理的缺页异常。
+ */
+bool memm_handle_page_fault(u64 address, u64 errcode);
+
 /**
  * @name is_user_address(addr)
  * @addindex 平台定制宏
@@ -241,6 +814,19 @@ extern void reload_pml4();
 #define is_user_address(addr) \
     (((addr) > 0xffff7fffffffffff) ? true : false)
 
+/**
+ * @name MEMM_USER_SPACE_START, MEMM_USER_SPACE_END
+ * @addindex 平台定制宏
+ *
+ * 可以被用户映射的地址范围`[MEMM_USER_SPACE_START, MEMM_USER_SPACE_END)`。
+ *
+ * @if arch == x86_64
+ *  整个高地址的用户空间，除去最后一页，使范围的结束地址不会溢出。
+ * @endif
+ */
+#define MEMM_USER_SPACE_START ((u64)0xffff800000000000)
+#define MEMM_USER_SPACE_END ((u64)0xfffffffffffff000)
+
 /**
  * @name is_cannonical(addr)
  * @addindex 平台依赖宏 x86_64
@@ -258,11 +844,11 @@ extern void reload_pml4();
  *
  * 当地址`addr`是*4KB对齐*或*没有4KB对齐时*，都得到`MEMM_PAGE_SIZE_4K`。
  */
-#define memm_get_page_align(addr)               \
-    (is_aligned(addr, MEMM_PAGE_SIZE_1G)        \
-         ? MEMM_PAGE_SIZE_1G                    \
-         : (is_aligned(addr, MEMM_PAGE_SIZE_2M) \
-                ? MEMM_PAGE_SIZE_2M             \
+#define memm_get_page_align(addr)                                                  \
+    (is_aligned((addr), ((usize)MEMM_PAGE_SIZE_1G * MEMM_PAGE_SIZE))               \
+         ? MEMM_PAGE_SIZE_1G                                                       \
+         : (is_aligned((addr), ((usize)MEMM_PAGE_SIZE_2M * MEMM_PAGE_SIZE))        \
+                ? MEMM_PAGE_SIZE_2M                                                \
                 : MEMM_PAGE_SIZE_4K))
 
 /**
@@ -273,6 +859,10 @@ extern void reload_pml4();
  * 
  * @if arch == x86_64
  *  使用三个成员分别记录`4KB`、`2MB`、`1GB`页的大小。
+ *
+ *  `promoted_xx_page`与`demoted_xx_page`记录合并出与拆分的大型页数量，`collapse_scanned`记录合并时扫描过的页表项数量。
+ *
+ *  `translation_hits`与`translation_misses`记录地址翻译时翻译缓存的命中与未命中次数。
  * @endif
  */
 typedef struct __memm_page_counter
@@ -280,6 +870,45 @@ typedef struct __memm_page_counter
     usize mapped_4k_page;
     usize mapped_2m_page;
     usize mapped_1g_page;
+
+    usize promoted_2m_page, promoted_1g_page;
+    usize demoted_2m_page, demoted_1g_page;
+    usize collapse_scanned;
+
+    usize translation_hits, translation_misses;
 } memm_page_counter;
 
+/**
+ * @name memm_page_counters
+ * @addindex 平台依赖宏 x86_64
+ *
+ * 大型页的合并与拆分的计数。
+ */
+extern memm_page_counter memm_page_counters;
+
+/**
+ * @name MEMM_COLLAPSE_BATCH
+ * @addindex 平台依赖宏 x86_64
+ *
+ * `memm_collapse_idle`每次最多读取的页表项数量，检查一个页表是否可以合并计为512项。
+ */
+#define MEMM_COLLAPSE_BATCH 4096
+
+/**
+ * @name memm_collapse_idle
+ *
+ * ```c
+ * void memm_collapse_idle();
+ * ```
+ *
+ * 由`memm_idle`调用，从上次停下的地址继续扫描当前地址空间的页表，把可以合并的页表合并为大型页并释放页表：
+ *
+ * * 512个pte映射属性相同的私有页，页框对齐且连续时合并为一个2MB页；
+ *   全部是匿名页框时复制到一个新分配的2MB块中，原来的页框被释放，空闲页框低于低水位时不复制。
+ * * 512个pde映射属性相同、对齐且连续的私有的非匿名2MB页，并且支持1GB页时合并为一个1GB页。
+ *
+ * 取消映射或修改大型页的一部分时大型页被拆分，匿名的2MB页拆分后重新放入LRU链表。
+ */
+void memm_collapse_idle();
+
 #endif
@@ -26,8 +26,20 @@ extern void *system_calls_table[256];
  *
  * 返回值 - rax
  * 
- * 系统调用时，使用内核主堆栈。
+ * 系统调用时，使用`syscall_init`分配的`SYSCALL_KERNEL_STACK_SIZE`字节的内核栈。调用号超出`system_calls_table`或对应项为空时返回-1。
+ * 除rax、rbx、rcx、rdi、r11以外的寄存器在返回时保持不变。
+ *
+ * 系统调用处理函数按System V调用约定接收参数，参数1\~6依次对应C函数的前6个参数，参数7、8通过堆栈传递。
+ */
+
+/**
+ * @name SYSCALL_KERNEL_STACK_SIZE
+ * @addindex 平台定制宏 x86_64
+ *
+ * 系统调用使用的内核栈的字节数。堆栈缓存只有一份，只在启动处理器上分配，
+ * 开启其它处理器之前需要改为每个处理器一份并通过`swapgs`取得。
  */
+#define SYSCALL_KERNEL_STACK_SIZE (64 * 1024)
 
 /**
  * @name set_kernel_stack_cache
@@ -37,7 +49,7 @@ extern void *system_calls_table[256];
  * void set_kernel_stack_cache(usize stack);
  * ```
  * 
- * 将堆栈缓存设为一个`stack`。
+ * 将堆栈缓存设为一个`stack`，`stack`为栈顶地址，按16字节对齐。
  */
 extern void set_kernel_stack_cache(usize stack);
 
@@ -0,0 +1,53 @@
+#ifndef FPU_H
+#define FPU_H 1
+
+#include <types.h>
+
+#ifdef __x86_64__
+#include <kernel/arch/x86_64/fpu.h>
+#endif
+
+/**
+ * @name kernel_fpu_size
+ *
+ * 一个保存区的字节数，由`kernel_fpu_init`通过`cpuid`取得。
+ */
+extern usize kernel_fpu_size;
+
+/**
+ * @name kernel_fpu_init
+ * @addindex 平台定制函数
+ *
+ * ```c
+ * void kernel_fpu_init();
+ * ```
+ *
+ * 在当前处理器上开启FPU、SSE与XSAVE，按处理器支持开启AVX与AVX-512的状态分量，并分配保存区。
+ * 每个处理器启动时调用一次，需要在内存管理器初始化之后。
+ */
+void kernel_fpu_init();
+
+/**
+ * @name kernel_fpu_begin, kernel_fpu_end
+ * @addindex 平台定制函数
+ *
+ * ```c
+ * bool kernel_fpu_begin();
+ * void kernel_fpu_end();
+ * ```
+ *
+ * 内核代码只能在两者之间使用FPU与向量寄存器。`kernel_fpu_begin`返回false时不能使用，调用者使用标量的实现，
+ * 此时不调用`kernel_fpu_end`。
+ *
+ * 状态按需保存：一个中断第一次进入时保存被打断的上下文的状态，之后的进入不再保存，状态在中断返回时才恢复。
+ * 不在中断中时，最外层的`kernel_fpu_begin`保存、对应的`kernel_fpu_end`恢复，
+ * 因此系统调用与空闲时的页回收等都不会把自己的状态留给之后的上下文。
+ * 可以嵌套，也可以在中断中使用。逐页处理大量数据的循环在循环外开启一个区间，每一页的区间只增加嵌套数量。
+ *
+ * 使用向量寄存器的C代码放在单独的文件中并加入`SIMD_C_SRCS`，只有这些文件使用SSE编译；
+ * rust代码通过`#[target_feature(enable = "sse2")]`在单个函数中开启。
+ */
+bool kernel_fpu_begin();
+void kernel_fpu_end();
+
+#endif
@@ -48,6 +48,26 @@
     }
 #define simple_lock_unlock(lock) (lock) = false;
 
+/**
+ * @name KERNEL_CPU_MAX
+ *
+ * 支持的最大处理器数量。
+ */
+#define KERNEL_CPU_MAX 64
+
+/**
+ * @name kernel_cpu_id
+ *
+ * ```c
+ * #define kernel_cpu_id()
+ * ```
+ *
+ * 当前处理器的编号，用于访问每CPU数据。
+ *
+ * 暂时只启动了引导处理器，总为0。
+ */
+#define kernel_cpu_id() ((usize)0)
+
 /**
  * @name kmain_rust
  * 
@@ -5,7 +5,15 @@
 #include <kernel/arch/x86_64/memm.h>
 #endif
 
-#include <libk/lst.h>
+#include <kernel/memm/buddy.h>
+#include <kernel/memm/numa.h>
+#include <kernel/memm/reclaim.h>
+#include <kernel/memm/zram.h>
+#include <kernel/memm/user.h>
+#include <kernel/memm/stat.h>
+
+#include <libk/itree.h>
+#include <libk/multiboot2.h>
 
 /**
  * @name MEMM_MAX_SUPPORTED_MEMORY
@@ -30,12 +38,63 @@
  */
 #define MEMM_ALLOC_ONLY_MEMORY (64 * 1024 * 1024)
 
+/**
+ * @name MEMM_PAGE_TABLE_AREA_MAX
+ *
+ * 引导时页表区域的大小，为固定值`4MB`，位于`MEMM_ALLOC_ONLY_MEMORY`之下。
+ */
 #define MEMM_PAGE_TABLE_AREA_MAX (4 * 1024 * 1024)
 
 /**
- * @name memm_allocate_t, memm_free_t
+ * @name MEMM_PAGE_TABLE_xx
+ *
+ * 页表页池的参数。
+ *
+ * * `MEMM_PAGE_TABLE_GROW_ORDER`：页表区域与空闲链表都用完后，每次从页框分配器取得`2^MEMM_PAGE_TABLE_GROW_ORDER`页补充页表页池。
+ * * `MEMM_PAGE_TABLE_ZERO_BATCH`：`memm_idle`每次最多清零的页表页数量。
+ */
+#define MEMM_PAGE_TABLE_GROW_ORDER 9
+#define MEMM_PAGE_TABLE_ZERO_BATCH 8
+
+/**
+ * @name MEMM_ZERO_POOL_xx
+ *
+ * 清零页框池的参数。
+ *
+ * * `MEMM_ZERO_POOL_TARGET`：每个NUMA节点的池中预先清零的页框数量上限。
+ * * `MEMM_ZERO_POOL_BATCH`：`memm_idle`每次最多补充的页框数量。
+ */
+#define MEMM_ZERO_POOL_TARGET 256
+#define MEMM_ZERO_POOL_BATCH 8
+
+/**
+ * @name MEMM_KERNEL_SLAB_SIZE
+ *
+ * 内核镜像结尾之后交给内核slab分配器的空间，为固定值`8MB`。
+ */
+#define MEMM_KERNEL_SLAB_SIZE (8 * 1024 * 1024)
+
+/**
+ * @name MEMM_KERNEL_ALLOCATOR
+ *
+ * 内核大分配器的类型，默认为`MEMM_TLSF_ALLOCATOR`。编译时可以通过`kallocator`选项替换，如`make kallocator=raw`。
+ */
+#ifndef MEMM_KERNEL_ALLOCATOR
+#define MEMM_KERNEL_ALLOCATOR MEMM_TLSF_ALLOCATOR
+#endif
+
+/**
+ * @name MEMM_KERNEL_HEAP_GROW_ORDER
+ *
+ * 内核分配器空间不足时，每次从页框分配器取得`2^MEMM_KERNEL_HEAP_GROW_ORDER`页（`2MB`）创建新的分配器。
+ * 更大的请求按需要的大小向上取整到2的幂。
+ */
+#define MEMM_KERNEL_HEAP_GROW_ORDER 9
+
+/**
+ * @name memm_allocate_t, memm_free_t, memm_usable_size_t, memm_free_sized_t
  *
- * 分配器的一对`分配`、`释放`函数指针。内核中可以根据情况使用多种不同的分配器来分配内存，`allocator`中提供一对此类型的变量，用于
+ * 分配器的`分配`、`释放`、`可用大小`与`按大小释放`函数指针。内核中可以根据情况使用多种不同的分配器来分配内存，`allocator`中提供一对此类型的变量，用于
  * 动态绑定不同的分配器。
  *
  * 分配器在`kernel/memm/allocator/`中定义。
@@ -52,6 +111,7 @@
  *
  * 无法分配空间时返回`nullptr`；当参数`size`为0时，需要检查分配器占有的空间的可用性，无可用空间时需要返回`nullptr`；
  * **返回的地址的16字节前**必须保留8字节空间用于存放内存所在分配器的内核空间地址。
+ * 这个地址的低4位用于保存分配标签（见`memm_tag`），第4位为`MEMM_ALLOCATOR_OFFSET`，因此分配器必须32字节对齐。
  *
  * **`memm_free_t`**：
  *
@@ -62,9 +122,38 @@
  * 释放分配器`allocator`中的内存`mem`。
  *
  * 由于此函数只由内核调用，因此对参数作出保证，保证地址`mem`属于这个`allocator`。
+ *
+ * **`memm_usable_size_t`**：
+ *
+ * ```c
+ * typedef usize (*memm_usable_size_t)(void *allocator, void *mem);
+ * ```
+ *
+ * 返回已分配的内存`mem`实际可用的字节数，不小于分配时请求的大小。用于内核内存统计。
+ *
+ * **`memm_free_sized_t`**（可选）：
+ *
+ * ```c
+ * typedef usize (*memm_free_sized_t)(void *allocator, void *mem, usize size);
+ * ```
+ *
+ * 释放分配时请求`size`字节的内存`mem`，返回它的可用字节数。分配器可以由`size`直接找到内存所在的位置，不需要查找。
  */
 typedef void *(*memm_allocate_t)(void *allocator, usize size);
 typedef void (*memm_free_t)(void *allocator, void *mem);
+typedef usize (*memm_usable_size_t)(void *allocator, void *mem);
+typedef usize (*memm_free_sized_t)(void *allocator, void *mem, usize size);
+
+/**
+ * @name MEMM_ALLOCATOR_OFFSET, MEMM_KERNEL_ALIGN
+ *
+ * `MEMM_ALLOCATOR_OFFSET`设置在返回地址16字节前的分配器地址中，表示这块内存是`memm_kernel_allocate_aligned`
+ * 从分配器返回的内存中对齐后得到的，分配器返回的地址存放在返回地址8字节前。
+ *
+ * `MEMM_KERNEL_ALIGN`是`memm_kernel_allocate`总能满足的对齐，为`16`字节。
+ */
+#define MEMM_ALLOCATOR_OFFSET ((usize)16)
+#define MEMM_KERNEL_ALIGN 16
 
 /**
  * @name allocator_t
@@ -77,9 +166,12 @@ typedef void (*memm_free_t)(void *allocator, void *mem);
  *
  * 内存分配器用于为`memm_allocate`函数提供管理数据以及分配空间。
  *
- * 在**内核镜像结尾**至`MEMM_ALLOC_ONLY_MEMORY`空间中，包含一个分配器`内核大分配器`。
+ * 在**内核镜像结尾**至`MEMM_ALLOC_ONLY_MEMORY`空间中，包含一个分配小对象的`内核slab分配器`和一个分配器`内核大分配器`。
  *
  * 分配器指针**必须**使用内核地址。
+ *
+ * 同一用途的分配器串成一条分配器链，链头是固定区域中的分配器。链上的分配器都满时，
+ * 从页框分配器取得页框创建新的分配器接入链中；由页框创建的分配器中的内存全部释放后归还页框分配器。
  * 
  * @internal magic
  * 
@@ -111,6 +203,26 @@ typedef void (*memm_free_t)(void *allocator, void *mem);
  *
  * 分配器实例的free函数。若不是allocate得到的地址则什么都不做。
  *
+ * @internal usable_size
+ *
+ * 分配器实例的usable_size函数。
+ *
+ * @internal free_sized
+ *
+ * 分配器实例的free_sized函数，分配器不支持时为`nullptr`。
+ *
+ * @internal prev, next
+ *
+ * 分配器链。
+ *
+ * @internal used
+ *
+ * 通过`memm_kernel_allocate`分配且尚未释放的内存块数量。
+ *
+ * @internal physical, order
+ *
+ * 分配器占用的页框，由`memm_alloc_pages`取得。`physical`为0表示分配器位于固定区域。
+ *
  * @internal allocator_instance
  *
  * 分配器实例。
@@ -137,11 +249,76 @@ typedef struct __allocator_t
     memm_allocate_t allocate;
     // 分配器实例的free函数。若不是allocate得到的地址则什么都不做。
     memm_free_t free;
+    memm_usable_size_t usable_size;
+    memm_free_sized_t free_sized;
+
+    struct __allocator_t *prev, *next;
+    usize used;
+    u64 physical;
+    usize order;
 
     // 分配器实例。
     u64 allocator_instance[0];
 } allocator_t;
 
+/**
+ * @name memm_pagetable_pool_t
+ *
+ * 页表页池。
+ *
+ * 空闲的页表页按照是否已经清零分别存放在`zeroed`与`dirty`两个链表中，链表指针存放在页的前8字节。
+ * 分配时优先使用已清零的页，`memm_idle`在空闲时把`dirty`中的页清零后移入`zeroed`。
+ *
+ * @internal pending
+ *
+ * 被释放但可能仍被处理器缓存的页表页，在刷新TLB后通过`memm_pagetable_flushed`移入`dirty`。
+ */
+typedef struct __memm_pagetable_pool_t
+{
+    void *zeroed;
+    usize zeroed_amount;
+    void *dirty;
+    usize dirty_amount;
+    void *pending;
+} memm_pagetable_pool_t;
+
+/**
+ * @name memm_zero_pool_t
+ *
+ * 清零页框池，每个NUMA节点一个。
+ *
+ * 池中是已经从页框分配器取出并清零的单个页框，链表指针存放在页的前8字节，取出时清除。
+ * `memm_idle`用非临时存储清零页框后补充到池中，不会把有用的缓存行挤出缓存。
+ *
+ * @internal hits, misses
+ *
+ * 需要清零页框时池中有页框的次数，与池为空只能同步清零的次数，用于调整池的大小。
+ */
+typedef struct __memm_zero_pool_t
+{
+    void *pages;
+    usize amount;
+    usize hits;
+    usize misses;
+} memm_zero_pool_t;
+
+/**
+ * @name memm_lazy_region_t
+ *
+ * 按需映射的区域，通过`memm_lazy_region_register`登记。
+ *
+ * 区域中的页在第一次被访问触发缺页异常时才映射。`anonymous`为`true`时每页分配一个清零的页框，
+ * 否则映射到从`physical`开始的固定物理内存。
+ */
+typedef struct __memm_lazy_region_t
+{
+    u64 start, end;
+    u64 physical;
+    bool anonymous;
+    bool write;
+    memm_memory_type type;
+} memm_lazy_region_t;
+
 /**
  * @name 内存管理器
  *
@@ -156,9 +333,33 @@ typedef struct __mem_manager_t
 
     usize alloc_only_memory;
 
+    // 内核大分配器链与内核slab分配器链的链头。
     allocator_t *kernel_base_allocator;
+    allocator_t *kernel_slab_allocator;
+    // 保留的一个空分配器，避免在边界上反复创建和释放分配器。
+    allocator_t *kernel_spare_allocator;
 
+    // 已从引导时页表区域中取出的大小。
     usize page_table_area;
+    memm_pagetable_pool_t page_table_pool;
+
+    // 管理`MEMM_ALLOC_ONLY_MEMORY`以上物理内存的页框分配器，未初始化时为`nullptr`。
+    buddy_allocator_t *frame_allocator;
+    // NUMA拓扑与内核默认的页框分配策略。
+    memm_numa_t numa;
+    memm_numa_policy_t numa_policy;
+    memm_zero_pool_t zero_pools[MEMM_NUMA_NODE_MAX];
+    // 匿名页框的LRU链表与水位。
+    memm_reclaim_t reclaim;
+    // 被换出的匿名页的压缩内存。
+    memm_zram_t zram;
+
+    // 按需映射区域的区间树，节点的`data`指向`memm_lazy_region_t`。
+    itree_pool_t region_pool;
+    itree_t lazy_regions;
+
+    // 按分配标签与分配器链的内核内存统计。
+    memm_stat_t stat;
 } memory_manager_t;
 
 /**
@@ -201,7 +402,7 @@ allocator_t *memm_allocator_new(void *start, usize length, usize type, usize pid
  * void memm_allocator_destruct(allocator_t *allocator);
  * ```
  *
- * 释放分配器对象。
+ * 释放分配器对象。把分配器从所在的分配器链中删除，若分配器占用的空间来自页框分配器则归还这些页框。
  *
  * 只能被**内存回收模块**调用。
  */
@@ -211,12 +412,32 @@ void memm_allocator_destruct(allocator_t *allocator);
  * @name memm_kernel_allocate
  *
  * ```c
- * void *memm_kernel_allocate(usize size);
+ * void *memm_kernel_allocate(usize size, memm_tag tag);
+ * ```
+ *
+ * 为内核空间申请内存，`tag`为使用这块内存的子系统，内存的可用大小记录在当前处理器的`tag`计数中，释放时扣除。
+ *
+ * 不超过`SLAB_KMALLOC_MAX`字节的请求优先由`内核slab分配器`链分配，其余的由`内核大分配器`链分配。
+ * 链上的分配器都无法满足请求时扩展分配器链。
+ *
+ * 返回地址的16字节前写入所在分配器的地址与分配标签。`size`为0或无法分配时返回`nullptr`。
+ */
+void *memm_kernel_allocate(usize size, memm_tag tag);
+
+/**
+ * @name memm_kernel_allocate_aligned
+ *
+ * ```c
+ * void *memm_kernel_allocate_aligned(usize size, usize align, memm_tag tag);
  * ```
  *
- * 为内核空间申请内存。
+ * 申请以`align`字节对齐的内存，`align`必须是2的幂。不超过`MEMM_KERNEL_ALIGN`时同`memm_kernel_allocate`。
+ *
+ * 否则多申请`align - MEMM_KERNEL_ALIGN`字节，在其中取对齐的地址。地址不是分配器返回的地址时，
+ * 在返回地址16字节前写入带有`MEMM_ALLOCATOR_OFFSET`的分配器地址，8字节前写入分配器返回的地址。
+ * 通过`memm_free`释放。
  */
-void *memm_kernel_allocate(usize size);
+void *memm_kernel_allocate_aligned(usize size, usize align, memm_tag tag);
 
 /**
  * @name memm_free
@@ -225,10 +446,214 @@ void *memm_kernel_allocate(usize size);
  * void memm_free(void *mem);
  * ```
  *
- * 释放内存。
+ * 释放内存。通过返回地址16字节前的分配器地址找到所在的分配器与分配标签，`mem`为`nullptr`时什么都不做。
  */
 void memm_free(void *mem);
 
+/**
+ * @name memm_free_sized
+ *
+ * ```c
+ * void memm_free_sized(void *mem, usize size);
+ * ```
+ *
+ * 释放通过`memm_kernel_allocate`申请`size`字节得到的内存。
+ *
+ * 分配器支持`free_sized`时由`size`直接找到内存所在的位置，如slab分配器直接取得对应大小的缓存，不读取slab头部；
+ * 否则同`memm_free`。
+ */
+void memm_free_sized(void *mem, usize size);
+
+/**
+ * @name memm_allcate_pagetable, memm_free_pagetable
+ *
+ * ```c
+ * void *memm_allcate_pagetable();
+ * void memm_free_pagetable(void *table);
+ * ```
+ *
+ * 从页表页池中分配一个已清零的页表页，或把不再使用的页表页归还页表页池。
+ *
+ * 页表页依次从空闲链表、引导时页表区域和页框分配器中取得，返回内核空间地址，写入页表项前需要通过`virt_to_phys`转换。
+ * 无法分配时返回`nullptr`。
+ *
+ * 被归还的页表页在下一次`memm_pagetable_flushed`之后才会被再次分配。使用中的页表页记录在`MEMM_TAG_PAGE_TABLE`中。
+ */
 void *memm_allcate_pagetable();
+void memm_free_pagetable(void *table);
+
+/**
+ * @name memm_pagetable_flushed
+ *
+ * ```c
+ * void memm_pagetable_flushed();
+ * ```
+ *
+ * 在刷新TLB后调用，此后之前归还的页表页可以被再次分配。
+ */
+void memm_pagetable_flushed();
+
+/**
+ * @name memm_idle
+ *
+ * ```c
+ * void memm_idle();
+ * ```
+ *
+ * 在处理器空闲时调用，完成内存管理的后台工作，如预先清零页表页、补充当前节点的清零页框池、回收页框。每次调用只做少量工作。
+ */
+void memm_idle();
+
+/**
+ * @name memm_frame_init
+ *
+ * ```c
+ * void memm_frame_init(bootinfo_t *bootinfo);
+ * ```
+ *
+ * 根据bootinfo中的内存映射初始化页框分配器。
+ *
+ * 首先建立所有物理内存的直接映射，此后`phys_to_virt`有效。
+ *
+ * 页框分配器只管理`MEMM_ALLOC_ONLY_MEMORY`以上的可用内存，bootinfo本身占用的空间不会被分配。
+ * 页框描述符数组放在第一段足够大的可用内存中，通过直接映射访问。
+ */
+void memm_frame_init(bootinfo_t *bootinfo);
+
+/**
+ * @name MEMM_FRAME_xx
+ *
+ * `memm_alloc_pages`与`memm_free_pages`的标志位。
+ *
+ * * `MEMM_FRAME_COLD`：单个页框从每CPU链表的冷端取出或放入冷端。用于不会马上被处理器访问的页框，如DMA缓冲区。
+ * * `MEMM_FRAME_ZERO`：返回清零的页框。单个页框优先从节点的清零页框池中取出，池为空时同步清零。只用于分配。
+ * * `MEMM_FRAME_NORECLAIM`：无法分配时不直接回收，用于页回收自身的分配。只用于分配。
+ */
+#define MEMM_FRAME_COLD ((usize)1)
+#define MEMM_FRAME_ZERO ((usize)2)
+#define MEMM_FRAME_NORECLAIM ((usize)4)
+
+/**
+ * @name memm_alloc_pages, memm_free_pages
+ *
+ * ```c
+ * u64 memm_alloc_pages(usize order, usize flags);
+ * void memm_free_pages(u64 physical, usize order, usize flags);
+ * ```
+ *
+ * 分配或释放`2^order`个物理地址连续的页框，`order`最大为`BUDDY_MAX_ORDER`。
+ *
+ * `memm_alloc_pages`按照内核默认的NUMA策略选择节点。无法分配时先收回清零页框池，再通过`memm_reclaim`直接回收后重试。
+ *
+ * 释放匿名页框时它同时被移出LRU链表。
+ *
+ * 返回块的物理地址，以块的大小对齐，无法分配时返回0。内核通过`phys_to_virt`访问返回的页框，也可以通过`memm_map_pageframes_to`映射到需要的地址。
+ */
+u64 memm_alloc_pages(usize order, usize flags);
+void memm_free_pages(u64 physical, usize order, usize flags);
+
+/**
+ * @name memm_frame_get
+ *
+ * ```c
+ * memm_frame_t *memm_frame_get(u64 physical);
+ * ```
+ *
+ * 取得物理地址`physical`所在页框的描述符。页框不由页框分配器管理或处于空闲状态时返回`nullptr`。
+ */
+memm_frame_t *memm_frame_get(u64 physical);
+
+/**
+ * @name memm_zero_pool_stat
+ *
+ * ```c
+ * void memm_zero_pool_stat(memm_zero_pool_t *stat);
+ * ```
+ *
+ * 把所有节点的清零页框池的页框数量与命中、未命中次数相加后写入`stat`，`stat->pages`为`nullptr`。
+ */
+void memm_zero_pool_stat(memm_zero_pool_t *stat);
+
+/**
+ * @name memm_alloc_pages_node, memm_alloc_pages_policy
+ *
+ * ```c
+ * u64 memm_alloc_pages_node(usize order, usize flags, usize node);
+ * u64 memm_alloc_pages_policy(usize order, usize flags, memm_numa_policy_t *policy);
+ * ```
+ *
+ * 从NUMA节点`node`，或按照策略`policy`选择的节点分配页框。节点的内存不足时按距离从近到远使用其它节点。
+ *
+ * 其它同`memm_alloc_pages`。
+ */
+u64 memm_alloc_pages_node(usize order, usize flags, usize node);
+u64 memm_alloc_pages_policy(usize order, usize flags, memm_numa_policy_t *policy);
+
+/**
+ * @name memm_numa_local_node, memm_set_numa_policy
+ *
+ * ```c
+ * usize memm_numa_local_node();
+ * void memm_set_numa_policy(memm_numa_policy_t *policy);
+ * ```
+ *
+ * 取得当前处理器所在的NUMA节点；设置内核默认的页框分配策略，默认为`MEMM_NUMA_POLICY_LOCAL`。
+ */
+usize memm_numa_local_node();
+void memm_set_numa_policy(memm_numa_policy_t *policy);
+
+/**
+ * @name memm_lazy_region_register
+ *
+ * ```c
+ * bool memm_lazy_region_register(
+ *     u64 start, usize size,
+ *     bool anonymous, u64 physical,
+ *     bool write, memm_memory_type type);
+ * ```
+ *
+ * 登记从`start`开始`size`字节的按需映射区域，区域的边界向外扩展到页对齐。`anonymous`为`true`时忽略`physical`。
+ *
+ * 登记时不映射任何页。与已登记的区域重叠或无法分配区域描述符时返回false。
+ *
+ * 内核空间的区域是全局的，用户空间的区域登记在当前地址空间中，区域不能跨越两者。
+ */
+bool memm_lazy_region_register(
+    u64 start, usize size,
+    bool anonymous, u64 physical,
+    bool write, memm_memory_type type);
+
+/**
+ * @name memm_lazy_region_insert
+ *
+ * ```c
+ * itree_node_t *memm_lazy_region_insert(
+ *     itree_t *regions, u64 start, u64 end,
+ *     bool anonymous, u64 physical,
+ *     bool write, memm_memory_type type);
+ * ```
+ *
+ * 在区域树`regions`中插入页对齐的区域`[start, end)`，节点的`data`指向新分配的区域描述符。
+ * 与已有区域重叠或无法分配时返回`nullptr`。
+ */
+itree_node_t *memm_lazy_region_insert(
+    itree_t *regions, u64 start, u64 end,
+    bool anonymous, u64 physical,
+    bool write, memm_memory_type type);
+
+/**
+ * @name memm_lazy_populate
+ *
+ * ```c
+ * bool memm_lazy_populate(u64 address, bool write);
+ * ```
+ *
+ * 映射按需映射区域中`address`所在的页，由缺页异常处理程序调用。
+ *
+ * 固定物理内存的区域在区域与物理地址都允许时映射整个2MB页，减少之后的缺页异常。
+ *
+ * `address`不在任何区域中、对只读区域写入或无法分配页框与页表页时返回false。
+ */
+bool memm_lazy_populate(u64 address, bool write);
 
 #endif
@@ -8,32 +8,36 @@
 
 typedef struct __raw_allocator_cell
 {
-    usize capacity;         // 是content的长度
-    usize length;           // 是实际使用的长度
+    void *owner;            // 按照`memm_allocate_t`的约定保留给分配器地址
+    usize capacity;         // 是content的长度，最低两位为`RAW_ALLOCATOR_CELL_FREE`与`RAW_ALLOCATOR_CELL_PREV_FREE`
     u8 content[0];
 } raw_allocator_cell;
-#define raw_allocator_next_cell(cell) (raw_allocator_cell *)((void *)((cell)->content) + (cell)->capacity)
+#define RAW_ALLOCATOR_CELL_FREE ((usize)1)
+#define RAW_ALLOCATOR_CELL_PREV_FREE ((usize)2)
+#define raw_allocator_cell_capacity(cell) \
+    ((cell)->capacity & ~(RAW_ALLOCATOR_CELL_FREE | RAW_ALLOCATOR_CELL_PREV_FREE))
+#define raw_allocator_next_cell(cell) \
+    ((raw_allocator_cell *)((void *)((cell)->content) + raw_allocator_cell_capacity(cell)))
 
 /**
  * @name raw_allocator_t
  * 
- * 原始分配器。包括至少一个cell，分配时像cell的分裂一样将空白的一段分成两段，释放时，只把length归零，并不将cell合并。
+ * 原始分配器。包括至少一个cell，分配时从头查找第一个足够大的空cell，像cell的分裂一样将空白的一段分成两段。
  * 
- * `length`为0的cell称为空cell。
+ * 设置了`RAW_ALLOCATOR_CELL_FREE`的cell称为空cell。空cell的content的最后8字节存放它的capacity（边界标记），
+ * 后一个cell通过`RAW_ALLOCATOR_CELL_PREV_FREE`得知前一个cell为空。
  * 
- * 统计从上次细胞合并以来free的调用次数，当调用次数达到`RAW_ALLOCATOR_FREE_MAX`或无可用空间时触发细胞合并。
+ * 释放时由返回地址前的cell头部直接找到cell，并立即与前后相邻的空cell合并，因此不存在两个相邻的空cell，释放的时间与cell的数量无关。
  * 
- * 使用建议：只在少量allocate和free的情况下使用。使用大量allocate时效率低下并难以得到内存安全保证。
+ * 使用建议：只在少量allocate的情况下使用。分配时需要遍历cell，cell很多时效率低下。
  * 
- * @internal free_count
+ * @internal rest_memory
  * 
- * free方法的调用次数，达到`RAW_ALLOCATOR_FREE_MAX`时归零。
+ * 所有空cell的capacity之和。
  */
 typedef struct __raw_allocator_t
 {
     usize size;
-    usize free_count; // free调用计数
-#define RAW_ALLOCATOR_FREE_MAX 64
     usize rest_memory;
     raw_allocator_cell cells[0];
 } raw_allocator_t;
@@ -51,11 +55,12 @@ typedef struct __raw_allocator_t
 void raw_allocator_new(raw_allocator_t *allocator, usize size);
 
 /**
- * @name raw_allocator_allocate, raw_allocator_free
+ * @name raw_allocator_allocate, raw_allocator_free, raw_allocator_usable_size
  * 
- * `raw_allocator`的一对allocate, free方法。
+ * `raw_allocator`的allocate, free, usable_size方法。
  */
 void *raw_allocator_allocate(raw_allocator_t *allocator, usize size);
 void raw_allocator_free(raw_allocator_t *allocator, void *mem);
+usize raw_allocator_usable_size(raw_allocator_t *allocator, void *mem);
 
 #endif
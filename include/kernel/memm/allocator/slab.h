@@ -0,0 +1,195 @@
+#ifndef SLAB_H
+#define SLAB_H 1
+
+#include <types.h>
+#include <kernel/memm.h>
+
+#define MEMM_SLAB_ALLOCATOR 2
+
+/**
+ * @name SLAB_SIZE
+ *
+ * 每个slab占用一页，slab头部位于页的起始处，因此对象地址按页对齐即可得到所在的slab。
+ */
+#define SLAB_SIZE MEMM_PAGE_SIZE
+
+/**
+ * @name SLAB_OBJECT_HEADER_SIZE
+ *
+ * 每个对象前的16字节。前8字节按照`memm_allocate_t`的约定保留给分配器地址，
+ * 后8字节在对象空闲时存放空闲链表的下一个对象，因此空闲对象的内容不会被破坏，可以保持构造函数初始化后的状态。
+ */
+#define SLAB_OBJECT_HEADER_SIZE 16
+
+/**
+ * @name SLAB_KMALLOC_MIN, SLAB_KMALLOC_MAX
+ *
+ * 通用分配接口使用的大小分级，从`16`字节至`512`字节，每级加倍。
+ */
+#define SLAB_KMALLOC_MIN 16
+#define SLAB_KMALLOC_MAX 512
+#define SLAB_KMALLOC_CACHES 6
+
+/**
+ * @name SLAB_EMPTY_MAX
+ *
+ * 每个缓存最多保留的空slab数量，超过的空slab归还分配器。
+ */
+#define SLAB_EMPTY_MAX 2
+
+typedef void (*slab_ctor_t)(void *object);
+
+/**
+ * @name slab_t
+ *
+ * slab头部。
+ *
+ * @internal free
+ *
+ * 空闲对象链表。
+ *
+ * @internal inuse
+ *
+ * 已分配的对象数量。
+ */
+typedef struct __slab_t
+{
+    struct __slab_cache_t *cache;
+    struct __slab_t *prev, *next;
+    void *free;
+    usize inuse;
+} slab_t;
+
+#define SLAB_HEADER_SIZE ((sizeof(slab_t) + 15) / 16 * 16)
+
+/**
+ * @name slab_cache_t
+ *
+ * 对象缓存。一个缓存只分配一种大小的对象。
+ *
+ * slab按照已分配对象的数量分别存放在`partial`、`full`、`empty`三个链表中，分配时优先使用`partial`中的slab。
+ *
+ * @internal slot_size
+ *
+ * 包含对象头部的槽大小。
+ *
+ * @internal ctor
+ *
+ * 对象构造函数，在slab创建时对其中的每个对象调用一次，可以为`nullptr`。
+ */
+typedef struct __slab_cache_t
+{
+    usize object_size;
+    usize slot_size;
+    usize objects_per_slab;
+    slab_ctor_t ctor;
+    slab_t *partial, *full, *empty;
+    usize empty_amount;
+    struct __slab_allocator_t *allocator;
+} slab_cache_t;
+
+/**
+ * @name slab_allocator_t
+ *
+ * slab分配器。分配器占有的空间按页划分为slab，由各个缓存按需取用。
+ *
+ * 使用建议：用于大量分配和释放`16`\~`512`字节的小对象。分配和释放的时间与分配器中的对象数量无关。
+ *
+ * @internal free_slabs
+ *
+ * 被缓存归还的空闲页链表。
+ *
+ * @internal brk, end
+ *
+ * 尚未被划分为slab的空间。
+ *
+ * @internal caches
+ *
+ * 通用分配接口使用的各级缓存。
+ *
+ * @internal cache_cache
+ *
+ * 分配`slab_cache_t`对象的缓存。
+ */
+typedef struct __slab_allocator_t
+{
+    usize size;
+    void *free_slabs;
+    void *brk, *end;
+    slab_cache_t caches[SLAB_KMALLOC_CACHES];
+    slab_cache_t cache_cache;
+} slab_allocator_t;
+
+/**
+ * @name slab_allocator_new
+ *
+ * ```c
+ * void slab_allocator_new(slab_allocator_t *allocator, usize size);
+ * ```
+ *
+ * 初始化一个`slab_allocator`。
+ */
+void slab_allocator_new(slab_allocator_t *allocator, usize size);
+
+/**
+ * @name slab_allocator_allocate, slab_allocator_free, slab_allocator_usable_size
+ *
+ * `slab_allocator`的allocate, free, usable_size方法。
+ *
+ * 只能分配不超过`SLAB_KMALLOC_MAX`字节的内存。
+ */
+void *slab_allocator_allocate(slab_allocator_t *allocator, usize size);
+void slab_allocator_free(slab_allocator_t *allocator, void *mem);
+usize slab_allocator_usable_size(slab_allocator_t *allocator, void *mem);
+
+/**
+ * @name slab_allocator_free_sized
+ *
+ * ```c
+ * usize slab_allocator_free_sized(slab_allocator_t *allocator, void *mem, usize size);
+ * ```
+ *
+ * `slab_allocator`的free_sized方法。`size`为分配时请求的大小，直接由它得到对象所在的缓存，不读取slab头部。
+ */
+usize slab_allocator_free_sized(slab_allocator_t *allocator, void *mem, usize size);
+
+/**
+ * @name slab_cache_create
+ *
+ * ```c
+ * slab_cache_t *slab_cache_create(slab_allocator_t *allocator, usize size, slab_ctor_t ctor);
+ * ```
+ *
+ * 在`allocator`中创建一个分配`size`字节对象的缓存，`ctor`为对象构造函数，可以为`nullptr`。
+ *
+ * 对象大小超过一个slab的容量或无法分配缓存结构时返回`nullptr`。
+ */
+slab_cache_t *slab_cache_create(slab_allocator_t *allocator, usize size, slab_ctor_t ctor);
+
+/**
+ * @name slab_cache_destroy
+ *
+ * ```c
+ * bool slab_cache_destroy(slab_cache_t *cache);
+ * ```
+ *
+ * 销毁一个缓存。缓存中还有已分配的对象时不做任何事并返回`false`。
+ */
+bool slab_cache_destroy(slab_cache_t *cache);
+
+/**
+ * @name slab_cache_alloc, slab_cache_free
+ *
+ * ```c
+ * void *slab_cache_alloc(slab_cache_t *cache);
+ * void slab_cache_free(slab_cache_t *cache, void *object);
+ * ```
+ *
+ * 从缓存中分配一个对象，或把对象归还缓存。没有可用空间时返回`nullptr`。
+ *
+ * 通过构造函数初始化的对象在归还时应恢复为初始化后的状态。
+ */
+void *slab_cache_alloc(slab_cache_t *cache);
+void slab_cache_free(slab_cache_t *cache, void *object);
+
+#endif
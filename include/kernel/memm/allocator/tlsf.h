@@ -0,0 +1,100 @@
+#ifndef TLSF_H
+#define TLSF_H 1
+
+#include <types.h>
+#include <kernel/memm.h>
+
+#define MEMM_TLSF_ALLOCATOR 3
+
+/**
+ * @name TLSF_xx
+ *
+ * 两级分级的参数。
+ *
+ * 块大小以`16`字节对齐。小于`TLSF_SMALL_BLOCK_SIZE`的块按`16`字节线性分级，
+ * 其余的块先按最高位分为一级，每一级再线性地分为`TLSF_SL_INDEX_COUNT`个二级。
+ * 一级最大为`2^TLSF_FL_INDEX_MAX`字节。
+ */
+#define TLSF_ALIGN_SIZE_LOG2 4
+#define TLSF_ALIGN_SIZE (1 << TLSF_ALIGN_SIZE_LOG2)
+#define TLSF_SL_INDEX_COUNT_LOG2 4
+#define TLSF_SL_INDEX_COUNT (1 << TLSF_SL_INDEX_COUNT_LOG2)
+#define TLSF_FL_INDEX_MAX 32
+#define TLSF_FL_INDEX_SHIFT (TLSF_SL_INDEX_COUNT_LOG2 + TLSF_ALIGN_SIZE_LOG2)
+#define TLSF_FL_INDEX_COUNT (TLSF_FL_INDEX_MAX - TLSF_FL_INDEX_SHIFT + 1)
+#define TLSF_SMALL_BLOCK_SIZE (1 << TLSF_FL_INDEX_SHIFT)
+
+/**
+ * @name tlsf_block_t
+ *
+ * 块头部，位于返回的地址前16字节。
+ *
+ * 空闲块的内容中存放空闲链表指针，内容的最后8字节存放块头部的地址，
+ * 用于在释放物理上相邻的后一个块时找到这个块。
+ *
+ * @internal owner
+ *
+ * 按照`memm_allocate_t`的约定保留给分配器地址。
+ *
+ * @internal size
+ *
+ * 块内容的大小，最低两位分别为`TLSF_BLOCK_FREE`与`TLSF_BLOCK_PREV_FREE`。
+ */
+typedef struct __tlsf_block_t
+{
+    void *owner;
+    usize size;
+    struct __tlsf_block_t *next_free, *prev_free;
+} tlsf_block_t;
+
+#define TLSF_BLOCK_FREE ((usize)1)
+#define TLSF_BLOCK_PREV_FREE ((usize)2)
+#define TLSF_BLOCK_HEADER_SIZE 16
+#define TLSF_BLOCK_SIZE_MIN 32
+
+/**
+ * @name tlsf_allocator_t
+ *
+ * TLSF分配器。分配与释放只需要常数次位扫描和链表操作，释放时立即与物理上相邻的空闲块合并，
+ * 因此最坏情况下的耗时与堆中的块数量无关。
+ *
+ * 使用建议：用作内核大分配器，或用于中断处理等对延迟敏感的场合。
+ *
+ * @internal fl_bitmap, sl_bitmap
+ *
+ * 一级与二级位图，为1的位表示对应的空闲链表非空。
+ *
+ * @internal blocks
+ *
+ * 各级空闲链表。
+ */
+typedef struct __tlsf_allocator_t
+{
+    usize size;
+    usize rest_memory;
+    u32 fl_bitmap;
+    u32 sl_bitmap[TLSF_FL_INDEX_COUNT];
+    tlsf_block_t *blocks[TLSF_FL_INDEX_COUNT][TLSF_SL_INDEX_COUNT];
+} tlsf_allocator_t;
+
+/**
+ * @name tlsf_allocator_new
+ *
+ * ```c
+ * void tlsf_allocator_new(tlsf_allocator_t *allocator, usize size);
+ * ```
+ *
+ * 初始化一个`tlsf_allocator`。
+ */
+void tlsf_allocator_new(tlsf_allocator_t *allocator, usize size);
+
+/**
+ * @name tlsf_allocator_allocate, tlsf_allocator_free, tlsf_allocator_usable_size
+ *
+ * `tlsf_allocator`的allocate, free, usable_size方法。
+ */
+void *tlsf_allocator_allocate(tlsf_allocator_t *allocator, usize size);
+void tlsf_allocator_free(tlsf_allocator_t *allocator, void *mem);
+usize tlsf_allocator_usable_size(tlsf_allocator_t *allocator, void *mem);
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef BUDDY_H
+#define BUDDY_H 1
+
+#include <types.h>
+#include <kernel/kernel.h>
+
+#ifdef __x86_64__
+#include <kernel/arch/x86_64/memm.h>
+#endif
+
+/**
+ * @name BUDDY_MAX_ORDER
+ *
+ * 伙伴分配器支持的最大阶。第`n`阶的块包含`2^n`个连续页框，最大阶对应`1GB`。
+ */
+#define BUDDY_MAX_ORDER 18
+
+/**
+ * @name BUDDY_ZONE_MAX
+ *
+ * 最大内存区域数量。每个NUMA节点的每段内存占用一个区域。
+ */
+#define BUDDY_ZONE_MAX 16
+
+/**
+ * @name BUDDY_NULL_PFN
+ *
+ * 空页框号。页框0永远不由伙伴分配器管理，因此用作链表的空指针。
+ */
+#define BUDDY_NULL_PFN 0
+
+/**
+ * @name memm_frame_t
+ *
+ * 页框描述符，每个物理页框对应一个，以页框号为下标存放在`buddy_allocator_t::frames`中。
+ *
+ * @internal prev, next
+ *
+ * 页框所在链表中前后相邻的页框号。空闲块的首个页框、每CPU链表中的页框与LRU链表中的页框使用。
+ *
+ * @internal flags
+ *
+ * `MEMM_FRAME_FLAG_xx`的组合。
+ *
+ * @internal order
+ *
+ * 页框作为块首时所在块的阶。
+ *
+ * @internal zone
+ *
+ * 页框所在内存区域的下标。
+ *
+ * @internal refcount
+ *
+ * 页框的引用计数。被多个地址空间共享时为共享者的数量，见`MEMM_ENTRY_FLAG_SHARED`；没有被共享时为0。
+ *
+ * @internal space, address
+ *
+ * 匿名页框的反向映射，即映射它的地址空间与虚拟地址。只在页框位于LRU链表中时有效。
+ */
+typedef struct __memm_frame_t
+{
+    u32 prev, next;
+    u16 flags;
+    u8 order;
+    u8 zone;
+    u32 refcount;
+    memm_address_space_t *space;
+    u64 address;
+} memm_frame_t;
+
+// 页框是伙伴分配器空闲链表中一个块的首个页框
+#define MEMM_FRAME_FLAG_FREE ((u16)1)
+// 页框在每CPU冷热页链表中
+#define MEMM_FRAME_FLAG_PCP ((u16)1 << 1)
+// 页框不由伙伴分配器管理
+#define MEMM_FRAME_FLAG_RESERVED ((u16)1 << 2)
+// 页框是按需映射的匿名页，只被映射它的页表项使用，取消映射时被释放
+#define MEMM_FRAME_FLAG_ANONYMOUS ((u16)1 << 3)
+// 页框在LRU链表中，同时设置`MEMM_FRAME_FLAG_ACTIVE`时在活跃链表中
+#define MEMM_FRAME_FLAG_LRU ((u16)1 << 4)
+#define MEMM_FRAME_FLAG_ACTIVE ((u16)1 << 5)
+
+/**
+ * @name buddy_list_t
+ *
+ * 以页框号连接的双向链表，通过`buddy_list_push_front`、`buddy_list_push_back`与`buddy_list_remove`操作。
+ */
+typedef struct __buddy_list_t
+{
+    u32 head, tail;
+    usize count;
+} buddy_list_t;
+
+static inline void buddy_list_push_front(memm_frame_t *frames, buddy_list_t *list, u32 pfn)
+{
+    frames[pfn].prev = BUDDY_NULL_PFN;
+    frames[pfn].next = list->head;
+    if (list->head != BUDDY_NULL_PFN)
+        frames[list->head].prev = pfn;
+    else
+        list->tail = pfn;
+    list->head = pfn;
+    list->count++;
+}
+
+static inline void buddy_list_push_back(memm_frame_t *frames, buddy_list_t *list, u32 pfn)
+{
+    frames[pfn].next = BUDDY_NULL_PFN;
+    frames[pfn].prev = list->tail;
+    if (list->tail != BUDDY_NULL_PFN)
+        frames[list->tail].next = pfn;
+    else
+        list->head = pfn;
+    list->tail = pfn;
+    list->count++;
+}
+
+static inline void buddy_list_remove(memm_frame_t *frames, buddy_list_t *list, u32 pfn)
+{
+    memm_frame_t *frame = &frames[pfn];
+    if (frame->prev != BUDDY_NULL_PFN)
+        frames[frame->prev].next = frame->next;
+    else
+        list->head = frame->next;
+    if (frame->next != BUDDY_NULL_PFN)
+        frames[frame->next].prev = frame->prev;
+    else
+        list->tail = frame->prev;
+    frame->prev = frame->next = BUDDY_NULL_PFN;
+    list->count--;
+}
+
+/**
+ * @name buddy_pcp_t
+ *
+ * 每CPU的0阶页框缓存。
+ *
+ * 链表头部是最近释放的热页，尾部是冷页。单页的分配与释放只操作这个链表，链表为空时从伙伴系统中批量取出`batch`个页框，
+ * 长度超过`high`时把尾部`batch`个冷页归还伙伴系统。
+ */
+typedef struct __buddy_pcp_t
+{
+    buddy_list_t list;
+    usize high, batch;
+} buddy_pcp_t;
+
+#define BUDDY_PCP_HIGH 256
+#define BUDDY_PCP_BATCH 32
+
+/**
+ * @name buddy_zone_t
+ *
+ * 内存区域。页框号在`[start_pfn, end_pfn)`内的页框由同一组空闲链表管理，伙伴块不会跨越区域合并。
+ *
+ * 区域的范围可以重叠，页框属于它的`memm_frame_t::zone`所指的区域，后创建的区域覆盖先创建的区域。
+ */
+typedef struct __buddy_zone_t
+{
+    usize start_pfn, end_pfn;
+    usize free_pages;
+    buddy_list_t free_area[BUDDY_MAX_ORDER + 1];
+    buddy_pcp_t pcp[KERNEL_CPU_MAX];
+    volatile u8 lock;
+} buddy_zone_t;
+
+/**
+ * @name buddy_allocator_t
+ *
+ * 二进制伙伴页框分配器。
+ *
+ * @internal frames
+ *
+ * 页框描述符数组，覆盖物理地址`0`至最高可用内存。
+ *
+ * @internal frame_amount
+ *
+ * 页框描述符数量。
+ */
+typedef struct __buddy_allocator_t
+{
+    memm_frame_t *frames;
+    usize frame_amount;
+    usize zone_amount;
+    buddy_zone_t zones[BUDDY_ZONE_MAX];
+} buddy_allocator_t;
+
+#define buddy_pfn_to_phys(pfn) ((u64)(pfn) * MEMM_PAGE_SIZE)
+#define buddy_phys_to_pfn(phys) ((usize)(phys) / MEMM_PAGE_SIZE)
+
+/**
+ * @name buddy_allocator_new
+ *
+ * ```c
+ * void buddy_allocator_new(buddy_allocator_t *allocator, memm_frame_t *frames, usize frame_amount);
+ * ```
+ *
+ * 初始化伙伴分配器。所有页框初始均为保留状态，之后通过`buddy_zone_new`与`buddy_add_range`加入可用的页框。
+ */
+void buddy_allocator_new(buddy_allocator_t *allocator, memm_frame_t *frames, usize frame_amount);
+
+/**
+ * @name buddy_zone_new
+ *
+ * ```c
+ * buddy_zone_t *buddy_zone_new(buddy_allocator_t *allocator, usize start_pfn, usize end_pfn);
+ * ```
+ *
+ * 创建一个内存区域，区域数量已满时返回`nullptr`。
+ */
+buddy_zone_t *buddy_zone_new(buddy_allocator_t *allocator, usize start_pfn, usize end_pfn);
+
+/**
+ * @name buddy_add_range
+ *
+ * ```c
+ * void buddy_add_range(buddy_allocator_t *allocator, buddy_zone_t *zone, usize start_pfn, usize end_pfn);
+ * ```
+ *
+ * 把页框`[start_pfn, end_pfn)`作为空闲页框加入区域`zone`。
+ */
+void buddy_add_range(buddy_allocator_t *allocator, buddy_zone_t *zone, usize start_pfn, usize end_pfn);
+
+/**
+ * @name buddy_allocate, buddy_free
+ *
+ * ```c
+ * u64 buddy_allocate(buddy_allocator_t *allocator, buddy_zone_t *zone, usize order, bool cold);
+ * void buddy_free(buddy_allocator_t *allocator, u64 physical, usize order, bool cold);
+ * ```
+ *
+ * 在区域`zone`中分配或释放一个`order`阶的块，使用物理地址。无法分配时返回0。
+ *
+ * 0阶的块经过每CPU冷热页链表，`cold`为`true`时取用或放入链表的冷端。
+ */
+u64 buddy_allocate(buddy_allocator_t *allocator, buddy_zone_t *zone, usize order, bool cold);
+void buddy_free(buddy_allocator_t *allocator, u64 physical, usize order, bool cold);
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef NUMA_H
+#define NUMA_H 1
+
+#include <types.h>
+#include <kernel/kernel.h>
+#include <kernel/memm/buddy.h>
+
+/**
+ * @name MEMM_NUMA_NODE_MAX
+ *
+ * 支持的最大NUMA节点数量，更多的节点被并入节点0。
+ */
+#define MEMM_NUMA_NODE_MAX 8
+
+/**
+ * @name MEMM_NUMA_LOCAL_DISTANCE, MEMM_NUMA_REMOTE_DISTANCE
+ *
+ * 节点之间的相对距离，与SLIT中的定义相同。没有SLIT时使用这两个值。
+ */
+#define MEMM_NUMA_LOCAL_DISTANCE 10
+#define MEMM_NUMA_REMOTE_DISTANCE 20
+
+/**
+ * @name memm_numa_node_t
+ *
+ * NUMA节点。
+ *
+ * @internal domain
+ *
+ * 节点在ACPI中的邻近域编号。
+ *
+ * @internal zones
+ *
+ * 节点拥有的内存区域在`buddy_allocator_t::zones`中的下标。
+ *
+ * @internal fallback
+ *
+ * 所有节点按与此节点的距离从近到远排列，第一个是节点自身。本节点的内存不足时依次从这些节点分配。
+ */
+typedef struct __memm_numa_node_t
+{
+    u32 domain;
+    usize zone_amount;
+    u8 zones[BUDDY_ZONE_MAX];
+    u8 fallback[MEMM_NUMA_NODE_MAX];
+    usize page_amount;
+} memm_numa_node_t;
+
+/**
+ * @name memm_numa_t
+ *
+ * NUMA拓扑。没有SRAT时只有一个包含所有内存的节点0。
+ *
+ * @internal apic_node
+ *
+ * 以本地APIC ID为下标的处理器所在节点。
+ *
+ * @internal cpu_node
+ *
+ * 以`kernel_cpu_id()`为下标的处理器所在节点，处理器启动时通过`memm_numa_cpu_online`设置。
+ */
+typedef struct __memm_numa_t
+{
+    usize node_amount;
+    memm_numa_node_t nodes[MEMM_NUMA_NODE_MAX];
+    u8 distance[MEMM_NUMA_NODE_MAX][MEMM_NUMA_NODE_MAX];
+    u8 apic_node[256];
+    u8 cpu_node[KERNEL_CPU_MAX];
+} memm_numa_t;
+
+/**
+ * @name memm_numa_policy_t
+ *
+ * 页框分配策略。
+ *
+ * * `MEMM_NUMA_POLICY_LOCAL`：从当前处理器所在的节点分配
+ * * `MEMM_NUMA_POLICY_PREFERRED`：从节点`node`分配
+ * * `MEMM_NUMA_POLICY_INTERLEAVE`：每次分配依次使用下一个节点，`next`为下一次使用的节点
+ *
+ * 首选的节点内存不足时，都按照与它的距离从近到远使用其它节点。
+ */
+typedef enum __memm_numa_policy_type
+{
+    MEMM_NUMA_POLICY_LOCAL = 0,
+    MEMM_NUMA_POLICY_PREFERRED = 1,
+    MEMM_NUMA_POLICY_INTERLEAVE = 2,
+} memm_numa_policy_type;
+
+typedef struct __memm_numa_policy_t
+{
+    memm_numa_policy_type type;
+    usize node;
+    usize next;
+} memm_numa_policy_t;
+
+/**
+ * @name memm_numa_init
+ *
+ * ```c
+ * void memm_numa_init(memm_numa_t *numa, buddy_allocator_t *allocator);
+ * ```
+ *
+ * 根据ACPI的SRAT与SLIT建立NUMA拓扑，由`memm_frame_init`在加入页框之前调用。
+ *
+ * 调用时`allocator`中应只有区域0，它覆盖所有可分配的页框。SRAT中的每段内存创建一个区域，
+ * 不属于任何节点的内存留在区域0中，作为节点0最后使用的区域。
+ */
+void memm_numa_init(memm_numa_t *numa, buddy_allocator_t *allocator);
+
+/**
+ * @name memm_numa_cpu_online
+ *
+ * ```c
+ * void memm_numa_cpu_online(memm_numa_t *numa);
+ * ```
+ *
+ * 在处理器上调用，根据它的本地APIC ID记录它所在的节点。
+ */
+void memm_numa_cpu_online(memm_numa_t *numa);
+
+#endif
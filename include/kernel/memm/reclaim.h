@@ -0,0 +1,124 @@
+#ifndef RECLAIM_H
+#define RECLAIM_H 1
+
+#include <types.h>
+#include <kernel/memm/buddy.h>
+
+/**
+ * @name MEMM_RECLAIM_xx
+ *
+ * 页回收的参数。
+ *
+ * * `MEMM_RECLAIM_BATCH`：每次扫描LRU链表的页框数量，也是`memm_idle`每次最多回收的页框数量。
+ * * `MEMM_RECLAIM_LOW_DIVISOR`：空闲页框少于所有可分配页框的`1/MEMM_RECLAIM_LOW_DIVISOR`（低水位）时开始后台回收，
+ *   直到空闲页框达到低水位的两倍（高水位）。
+ * * `MEMM_RECLAIM_LOW_MIN`：低水位的最小值。
+ */
+#define MEMM_RECLAIM_BATCH 32
+#define MEMM_RECLAIM_LOW_DIVISOR 64
+#define MEMM_RECLAIM_LOW_MIN 256
+
+/**
+ * @name memm_shrinker_t
+ *
+ * 可回收的缓存，通过`memm_shrinker_register`登记。
+ *
+ * 缓存可以使用任意多的空闲内存，内存不足时`scan`被调用，释放最多`amount`个页框，返回实际释放的数量。
+ */
+typedef struct __memm_shrinker_t
+{
+    usize (*scan)(usize amount);
+    struct __memm_shrinker_t *next;
+} memm_shrinker_t;
+
+/**
+ * @name memm_reclaim_t
+ *
+ * 页回收的状态。
+ *
+ * 匿名页框在第一次映射时放入不活跃链表的头部。回收时从不活跃链表的尾部检查页表项的访问位：
+ * 被访问过的页框移入活跃链表，没有被访问也没有被写入的页框被取消映射并释放，被写入过的页框换出到压缩内存。
+ * 不活跃链表比活跃链表短时，活跃链表尾部没有被访问过的页框被移入不活跃链表。
+ *
+ * @internal low, high
+ *
+ * 低水位与高水位，以页框为单位。
+ *
+ * @internal pressure
+ *
+ * 空闲页框低于低水位后为true，`memm_idle`在后台回收直到空闲页框达到高水位。
+ *
+ * @internal scanned, reclaimed
+ *
+ * 扫描过与回收的页框数量。
+ */
+typedef struct __memm_reclaim_t
+{
+    buddy_list_t active, inactive;
+    usize low, high;
+    bool pressure;
+    memm_shrinker_t *shrinkers;
+    usize scanned, reclaimed;
+} memm_reclaim_t;
+
+/**
+ * @name memm_reclaim_init
+ *
+ * ```c
+ * void memm_reclaim_init(memm_reclaim_t *reclaim, usize page_amount);
+ * ```
+ *
+ * 根据可分配页框的数量`page_amount`设置水位，由`memm_frame_init`调用。
+ */
+void memm_reclaim_init(memm_reclaim_t *reclaim, usize page_amount);
+
+/**
+ * @name memm_lru_add, memm_lru_del
+ *
+ * ```c
+ * void memm_lru_add(u64 physical, memm_address_space_t *space, u64 address);
+ * void memm_lru_del(u64 physical);
+ * ```
+ *
+ * `memm_lru_add`把映射在`space`中`address`处的匿名页框放入不活跃链表，并标记为`MEMM_FRAME_FLAG_ANONYMOUS`。
+ *
+ * `memm_lru_del`把页框移出LRU链表，页框仍是匿名页框。被共享的页框不能被回收，在共享期间移出LRU链表。
+ */
+void memm_lru_add(u64 physical, memm_address_space_t *space, u64 address);
+void memm_lru_del(u64 physical);
+
+/**
+ * @name memm_reclaim
+ *
+ * ```c
+ * usize memm_reclaim(usize amount);
+ * ```
+ *
+ * 先从登记的缓存，再从LRU链表回收最多`amount`个页框，返回回收的数量。
+ * 每个LRU链表中的页框最多被扫描两次。
+ */
+usize memm_reclaim(usize amount);
+
+/**
+ * @name memm_reclaim_idle
+ *
+ * ```c
+ * void memm_reclaim_idle();
+ * ```
+ *
+ * 由`memm_idle`调用。空闲页框低于低水位时回收一批页框，否则在不活跃链表较短时老化活跃链表。
+ */
+void memm_reclaim_idle();
+
+/**
+ * @name memm_shrinker_register
+ *
+ * ```c
+ * void memm_shrinker_register(memm_shrinker_t *shrinker);
+ * ```
+ *
+ * 登记一个可回收的缓存。
+ */
+void memm_shrinker_register(memm_shrinker_t *shrinker);
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef STAT_H
+#define STAT_H 1
+
+#include <types.h>
+#include <kernel/kernel.h>
+
+/**
+ * @name memm_tag
+ *
+ * 内核内存的分配标签，记录内存被哪个子系统使用。
+ *
+ * * `MEMM_TAG_OTHER`：没有归类的分配。
+ * * `MEMM_TAG_TTY`：tty。
+ * * `MEMM_TAG_REGION`：按需映射区域的描述符与区间树节点。
+ * * `MEMM_TAG_RUST`：rust的全局分配器`KernelAllocator`，包括内核日志。
+ * * `MEMM_TAG_PAGE_TABLE`：页表页，由`memm_allcate_pagetable`与`memm_free_pagetable`记录。
+ *
+ * 通过`memm_kernel_allocate`分配时，标签保存在返回地址16字节前的分配器地址的低位中，因此最多有`MEMM_TAG_MASK + 1`个标签。
+ */
+typedef enum __memm_tag
+{
+    MEMM_TAG_OTHER = 0,
+    MEMM_TAG_TTY = 1,
+    MEMM_TAG_REGION = 2,
+    MEMM_TAG_RUST = 3,
+    MEMM_TAG_PAGE_TABLE = 4,
+    MEMM_TAG_AMOUNT,
+} memm_tag;
+
+#define MEMM_TAG_MASK ((usize)15)
+
+/**
+ * @name memm_tag_counter_t
+ *
+ * 一个处理器上一个标签的字节数与内存块数量。
+ *
+ * 内存可能在一个处理器上分配而在另一个处理器上释放，因此单个处理器的计数可以为负数，所有处理器的计数之和才是实际的使用量。
+ *
+ * @internal peak
+ *
+ * 此处理器上`bytes`达到过的最大值。
+ */
+typedef struct __memm_tag_counter_t
+{
+    isize bytes;
+    isize objects;
+    isize peak;
+} memm_tag_counter_t;
+
+/**
+ * @name MEMM_STAT_HISTOGRAM_SIZE
+ *
+ * 分配器链的内存块大小分布的项数。第`i`项记录可用大小在`[16 << i, 16 << (i + 1))`字节的内存块，最后一项包括所有更大的块。
+ */
+#define MEMM_STAT_HISTOGRAM_SIZE 20
+
+/**
+ * @name memm_allocator_stat_t
+ *
+ * 一条分配器链的统计。
+ *
+ * * `capacity`：链上所有分配器占有的字节数，包括分配器自身的管理结构。
+ * * `used`：已分配的内存块的可用字节数之和，`capacity - used`为链中的空闲空间与管理开销。
+ * * `histogram`：已分配的内存块按可用大小的分布，见`MEMM_STAT_HISTOGRAM_SIZE`。
+ */
+typedef struct __memm_allocator_stat_t
+{
+    usize capacity;
+    usize used;
+    usize histogram[MEMM_STAT_HISTOGRAM_SIZE];
+} memm_allocator_stat_t;
+
+/**
+ * @name memm_stat_t
+ *
+ * 内核内存的统计，位于内存管理器中。
+ *
+ * @internal cpu
+ *
+ * 每个处理器的标签计数，只由所在的处理器写入。
+ *
+ * @internal slab, base
+ *
+ * 内核slab分配器链与内核大分配器链的统计。
+ */
+typedef struct __memm_stat_t
+{
+    memm_tag_counter_t cpu[KERNEL_CPU_MAX][MEMM_TAG_AMOUNT];
+    memm_allocator_stat_t slab, base;
+} memm_stat_t;
+
+/**
+ * @name memm_tag_stat_t, memm_stat_snapshot_t
+ *
+ * `memm_stat_snapshot`的结果。
+ *
+ * `memm_tag_stat_t`中的`peak`是所有处理器的`peak`之和，是实际最大值的上界，只有一个处理器时与实际最大值相同。
+ */
+typedef struct __memm_tag_stat_t
+{
+    usize bytes;
+    usize objects;
+    usize peak;
+} memm_tag_stat_t;
+
+typedef struct __memm_stat_snapshot_t
+{
+    memm_tag_stat_t tags[MEMM_TAG_AMOUNT];
+    memm_allocator_stat_t slab, base;
+} memm_stat_snapshot_t;
+
+/**
+ * @name memm_stat_account
+ *
+ * ```c
+ * void memm_stat_account(memm_tag tag, isize bytes, isize objects);
+ * ```
+ *
+ * 在当前处理器上为标签`tag`增加`bytes`字节与`objects`个内存块，释放时为负数。
+ */
+void memm_stat_account(memm_tag tag, isize bytes, isize objects);
+
+/**
+ * @name memm_stat_snapshot
+ *
+ * ```c
+ * void memm_stat_snapshot(memm_stat_snapshot_t *snapshot);
+ * ```
+ *
+ * 把所有处理器的标签计数相加，与分配器链的统计一起写入`snapshot`。
+ *
+ * 只读取计数，不加锁也不停止其它处理器，因此各项不一定是同一时刻的值，可以在监控中频繁调用。
+ */
+void memm_stat_snapshot(memm_stat_snapshot_t *snapshot);
+
+#endif
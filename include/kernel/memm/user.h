@@ -0,0 +1,122 @@
+#ifndef USER_H
+#define USER_H 1
+
+#include <types.h>
+
+#ifdef __x86_64__
+#include <kernel/arch/x86_64/memm.h>
+#endif
+
+/**
+ * @name MEMM_USER_MAP_xx
+ *
+ * `memm_user_map`与`memm_user_protect`的标志。
+ *
+ * * `MEMM_USER_MAP_WRITE`：区域可以写入。
+ */
+#define MEMM_USER_MAP_WRITE 1
+
+/**
+ * @name MEMM_USER_HEAP_xx
+ *
+ * 用户堆的参数。
+ *
+ * * `MEMM_USER_HEAP_SIZE`：第一次分配时为用户堆保留的地址空间大小，为固定值`64GB`。页在第一次访问时才映射。
+ * * `MEMM_USER_HEAP_ALIGN`：分配的内存块的大小与地址都按此对齐。
+ */
+#define MEMM_USER_HEAP_SIZE ((usize)64 * 1024 * 1024 * 1024)
+#define MEMM_USER_HEAP_ALIGN 16
+
+/**
+ * @name memm_user_space_init, memm_user_space_destruct, memm_user_space_clone
+ *
+ * ```c
+ * void memm_user_space_init(memm_address_space_t *space);
+ * void memm_user_space_destruct(memm_address_space_t *space);
+ * bool memm_user_space_clone(memm_address_space_t *space, memm_address_space_t *source);
+ * ```
+ *
+ * 初始化、销毁或复制地址空间中用户空间的区域与用户堆，由地址空间的对应函数调用。
+ * 初始化时为地址空间分配新的进程标识符。复制时无法分配内存返回false。
+ */
+void memm_user_space_init(memm_address_space_t *space);
+void memm_user_space_destruct(memm_address_space_t *space);
+bool memm_user_space_clone(memm_address_space_t *space, memm_address_space_t *source);
+
+/**
+ * @name memm_address_space_find
+ *
+ * ```c
+ * memm_address_space_t *memm_address_space_find(usize pid);
+ * ```
+ *
+ * 查找进程标识符为`pid`的地址空间，不存在时返回`nullptr`。
+ */
+memm_address_space_t *memm_address_space_find(usize pid);
+
+/**
+ * @name memm_user_map
+ *
+ * ```c
+ * u64 memm_user_map(memm_address_space_t *space, u64 address, usize size, usize flags);
+ * ```
+ *
+ * 在`space`的用户空间中保留`size`字节的匿名区域，返回区域的起始地址，失败时返回0。
+ *
+ * `address`为0时选择地址最低的空闲范围，不小于2MB的区域按2MB对齐，之后可以被合并为大型页；
+ * 否则`address`必须页对齐且范围没有被使用。区域只被登记，页在第一次访问时映射为清零的页框。
+ */
+u64 memm_user_map(memm_address_space_t *space, u64 address, usize size, usize flags);
+
+/**
+ * @name memm_user_unmap, memm_user_protect
+ *
+ * ```c
+ * bool memm_user_unmap(memm_address_space_t *space, u64 address, usize size);
+ * bool memm_user_protect(memm_address_space_t *space, u64 address, usize size, usize flags);
+ * ```
+ *
+ * 取消保留或修改`space`中`[address, address + size)`的区域，`address`必须页对齐，`size`向上取整到页。
+ * 区域在范围的边界上被拆分，范围中已映射的页在一次页表遍历中取消映射或修改属性，TLB一起刷新。
+ *
+ * `memm_user_protect`要求整个范围都已被保留，修改后属性相同的相邻区域被合并。
+ */
+bool memm_user_unmap(memm_address_space_t *space, u64 address, usize size);
+bool memm_user_protect(memm_address_space_t *space, u64 address, usize size, usize flags);
+
+/**
+ * @name memm_user_allocate, memm_user_free
+ *
+ * ```c
+ * void *memm_user_allocate(usize size, usize pid);
+ * void memm_user_free(void *mem, usize pid);
+ * ```
+ *
+ * 在进程`pid`的用户堆中分配或释放内存，返回的是用户空间地址，失败时返回`nullptr`。
+ *
+ * 每个地址空间有自己的用户堆。内存块记录在地址空间的区间树中而不是用户可以写入的内存中，
+ * 节点来自地址空间自己的节点池，不使用内核分配器链。释放后完全空闲的页被取消映射。
+ */
+void *memm_user_allocate(usize size, usize pid);
+void memm_user_free(void *mem, usize pid);
+
+/**
+ * @name memm_syscall_xx
+ *
+ * ```c
+ * u64 memm_syscall_mmap(u64 address, u64 size, u64 flags);
+ * u64 memm_syscall_munmap(u64 address, u64 size);
+ * u64 memm_syscall_mprotect(u64 address, u64 size, u64 flags);
+ * u64 memm_syscall_allocate(u64 size);
+ * u64 memm_syscall_free(u64 mem);
+ * ```
+ *
+ * 内存管理的系统调用，操作当前地址空间。`mmap`与`allocate`返回地址，失败时返回0；`munmap`与`mprotect`成功时返回1。
+ */
+u64 memm_syscall_mmap(u64 address, u64 size, u64 flags);
+u64 memm_syscall_munmap(u64 address, u64 size);
+u64 memm_syscall_mprotect(u64 address, u64 size, u64 flags);
+u64 memm_syscall_allocate(u64 size);
+u64 memm_syscall_free(u64 mem);
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef ZRAM_H
+#define ZRAM_H 1
+
+#include <types.h>
+#include <kernel/memm/buddy.h>
+
+/**
+ * @name MEMM_ZRAM_xx
+ *
+ * 压缩内存的参数。
+ *
+ * * `MEMM_ZRAM_CLASS_SIZE`：压缩对象按此大小分级，每级的对象放在专用的页中。
+ * * `MEMM_ZRAM_OBJECT_MAX`：包括项头部的最大对象大小，一页至少能放下两个对象。压缩后更大的页不被换出。
+ * * `MEMM_ZRAM_HASH_BUCKETS`：按页内容的哈希值查找相同页的哈希表的大小。
+ */
+#define MEMM_ZRAM_CLASS_SIZE 64
+#define MEMM_ZRAM_OBJECT_MAX 1984
+#define MEMM_ZRAM_CLASS_AMOUNT (MEMM_ZRAM_OBJECT_MAX / MEMM_ZRAM_CLASS_SIZE)
+#define MEMM_ZRAM_HASH_BUCKETS 1024
+
+/**
+ * @name memm_zram_entry_t
+ *
+ * 压缩内存中的项，保存一页压缩后的内容，内容相同的页共用一个项。
+ *
+ * @internal refcount
+ *
+ * 引用这个项的pte数量。
+ *
+ * @internal size, data
+ *
+ * 以LZ4块格式压缩的内容。
+ */
+typedef struct __memm_zram_entry_t
+{
+    struct __memm_zram_entry_t *next;
+    u64 hash;
+    u32 refcount;
+    u16 size;
+    u8 data[0];
+} memm_zram_entry_t;
+
+/**
+ * @name memm_zram_page_t
+ *
+ * 存放一级压缩对象的页的头部，位于页的起始处，对象地址按页对齐即可得到所在的页。
+ *
+ * 还有空闲对象的页在这一级的链表中，对象全部被释放后页框归还页框分配器。
+ */
+typedef struct __memm_zram_page_t
+{
+    struct __memm_zram_page_t *prev, *next;
+    void *free;
+    u16 inuse;
+    u16 class;
+} memm_zram_page_t;
+
+/**
+ * @name memm_zram_t
+ *
+ * 压缩内存。没有被访问的匿名页被回收时，如果曾被写入，压缩后放入压缩内存，它的pte改为指向压缩内存中的项。
+ *
+ * 全0的页不保存内容，共用`zero`项；其它页按内容的哈希值查找内容相同的项。
+ *
+ * @internal stored_pages, unique_pages
+ *
+ * 被换出的页数，与实际保存的压缩对象数量。
+ *
+ * @internal fault_cycles, fault_cycles_max
+ *
+ * 换入所有页耗费的时钟周期总数，与单次换入的最大值。
+ */
+typedef struct __memm_zram_t
+{
+    memm_zram_page_t *partial[MEMM_ZRAM_CLASS_AMOUNT];
+    memm_zram_entry_t *buckets[MEMM_ZRAM_HASH_BUCKETS];
+    memm_zram_entry_t zero;
+
+    usize stored_pages, unique_pages;
+    usize compressed_bytes;
+    usize arena_pages;
+    usize deduplicated, rejected;
+    usize faults;
+    u64 fault_cycles, fault_cycles_max;
+} memm_zram_t;
+
+/**
+ * @name memm_zram_stat_t
+ *
+ * 压缩内存的统计信息，由`memm_zram_stat`填写。
+ *
+ * * `ratio`：被换出的页数与压缩内存占用的页框数之比的百分数，没有占用页框时为0。
+ * * `fault_cycles_avg`、`fault_cycles_max`：单次换入耗费的平均与最大时钟周期数。
+ */
+typedef struct __memm_zram_stat_t
+{
+    usize stored_pages, unique_pages, zero_pages;
+    usize compressed_bytes;
+    usize arena_pages;
+    usize deduplicated, rejected;
+    usize ratio;
+    usize faults;
+    u64 fault_cycles_avg, fault_cycles_max;
+} memm_zram_stat_t;
+
+/**
+ * @name memm_zram_swap_out
+ *
+ * ```c
+ * bool memm_zram_swap_out(u64 physical);
+ * ```
+ *
+ * 把LRU链表中的匿名页框`physical`换出到压缩内存并释放页框，由页回收调用。
+ *
+ * 页在换出前被取消映射，已被访问、压缩后过大或无法分配空间时恢复映射并返回false。
+ */
+bool memm_zram_swap_out(u64 physical);
+
+/**
+ * @name memm_zram_fault
+ *
+ * ```c
+ * u64 memm_zram_fault(void *entry);
+ * ```
+ *
+ * 分配一个页框并把项`entry`的内容解压到其中，返回页框的物理地址，无法分配时返回0。
+ * 调用者映射页框后通过`memm_zram_put`放弃对项的引用。
+ */
+u64 memm_zram_fault(void *entry);
+
+/**
+ * @name memm_zram_get, memm_zram_put
+ *
+ * ```c
+ * void memm_zram_get(void *entry);
+ * void memm_zram_put(void *entry);
+ * ```
+ *
+ * 增加或减少项的引用，用于复制或取消映射换出的页的pte。最后一个引用被放弃时释放项。
+ */
+void memm_zram_get(void *entry);
+void memm_zram_put(void *entry);
+
+/**
+ * @name memm_zram_stat
+ *
+ * ```c
+ * void memm_zram_stat(memm_zram_stat_t *stat);
+ * ```
+ *
+ * 取得压缩内存的统计信息。
+ */
+void memm_zram_stat(memm_zram_stat_t *stat);
+
+/**
+ * @name memm_zram_page_is_zero_simd, memm_zram_page_equal_simd
+ *
+ * ```c
+ * bool memm_zram_page_is_zero_simd(u64 *page);
+ * bool memm_zram_page_equal_simd(u64 *a, u64 *b);
+ * ```
+ *
+ * 使用SSE2检查一页是否全为0、两页内容是否相同，每次比较64字节。只能在`kernel_fpu_begin`与`kernel_fpu_end`之间调用。
+ */
+bool memm_zram_page_is_zero_simd(u64 *page);
+bool memm_zram_page_equal_simd(u64 *a, u64 *b);
+
+#endif
@@ -5,6 +5,23 @@
 #include <kernel/arch/x86_64/syscall.h>
 #endif
 
+/**
+ * @name SYSCALL_xx
+ *
+ * 系统调用号。
+ *
+ * * `SYSCALL_MMAP`：`memm_syscall_mmap`，保留一段匿名内存
+ * * `SYSCALL_MUNMAP`：`memm_syscall_munmap`，取消保留
+ * * `SYSCALL_MPROTECT`：`memm_syscall_mprotect`，修改访问权限
+ * * `SYSCALL_ALLOCATE`：`memm_syscall_allocate`，从进程的用户堆中分配
+ * * `SYSCALL_FREE`：`memm_syscall_free`，释放用户堆中的内存
+ */
+#define SYSCALL_MMAP 1
+#define SYSCALL_MUNMAP 2
+#define SYSCALL_MPROTECT 3
+#define SYSCALL_ALLOCATE 4
+#define SYSCALL_FREE 5
+
 /**
  * @name syscall_init
  * 
@@ -12,7 +29,7 @@
  * void syscall_init();
  * ```
  * 
- * 初始化系统调用。
+ * 初始化系统调用，登记所有系统调用处理函数。
  */
 void syscall_init();
 
@@ -25,4 +25,9 @@
 #define is_aligned(addr, align) \
     (addr % align == 0)
 
+// 最低的为1的位的序号，x不能为0
+#define bit_scan_forward(x) ((usize)__builtin_ctzll((u64)(x)))
+// 最高的为1的位的序号，x不能为0
+#define bit_scan_reverse(x) ((usize)(63 - __builtin_clzll((u64)(x))))
+
 #endif
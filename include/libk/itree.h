@@ -0,0 +1,186 @@
+#ifndef ITREE_H
+#define ITREE_H 1
+
+#include <types.h>
+
+/**
+ * @name ITREE_POOL_CHUNK
+ *
+ * 节点池每次向内核分配器申请的节点数量，其中第一个节点用于把申请到的内存串成链表。
+ */
+#define ITREE_POOL_CHUNK 64
+
+/**
+ * @name itree_node_t
+ *
+ * 区间树中的一个区间`[start,end)`，`data`由使用者自由使用。
+ *
+ * @internal min_start, max_end
+ *
+ * 以此节点为根的子树中最小的起始地址与最大的结束地址。
+ *
+ * @internal max_gap
+ *
+ * 子树中相邻两个区间之间最大的空隙，不包括子树两端以外的空隙。
+ */
+typedef struct __itree_node_t
+{
+    usize start, end;
+    void *data;
+
+    struct __itree_node_t *parent, *left, *right;
+    bool red;
+    usize min_start, max_end;
+    usize max_gap;
+} itree_node_t;
+
+/**
+ * @name itree_pool_t
+ *
+ * 区间树节点池，多棵区间树可以共用一个节点池。
+ *
+ * 节点按`ITREE_POOL_CHUNK`个一组从`memm_kernel_allocate`分配，被释放的节点放入空闲链表（借用`parent`字段），
+ * 在`itree_pool_destruct`时才归还内核分配器。
+ *
+ * @internal tag
+ *
+ * 向内核分配器申请节点时使用的分配标签`memm_tag`。
+ */
+typedef struct __itree_pool_t
+{
+    usize tag;
+    itree_node_t *free;
+    itree_node_t *chunks;
+    usize allocated, inuse;
+} itree_pool_t;
+
+/**
+ * @name itree_t
+ *
+ * 区间树，以区间的起始地址为键的红黑树，保存`[start,end)`中互不相交的区间。
+ *
+ * 每个节点记录子树的地址范围与子树中最大的空隙，插入、删除、点查找与首次适应的空隙查找都是O(log n)的。
+ */
+typedef struct __itree_t
+{
+    itree_node_t *root;
+    usize start, end;
+    usize amount;
+    itree_pool_t *pool;
+} itree_t;
+
+/**
+ * @name itree_pool_new, itree_pool_destruct
+ *
+ * ```c
+ * void itree_pool_new(itree_pool_t *pool, usize tag);
+ * void itree_pool_destruct(itree_pool_t *pool);
+ * ```
+ *
+ * 初始化一个空的节点池，节点的内存记录在分配标签`tag`中；或归还节点池的所有内存。销毁节点池后使用它的区间树都不能再使用。
+ */
+void itree_pool_new(itree_pool_t *pool, usize tag);
+void itree_pool_destruct(itree_pool_t *pool);
+
+/**
+ * @name itree_new
+ *
+ * ```c
+ * void itree_new(itree_t *tree, usize start, usize end, itree_pool_t *pool);
+ * ```
+ *
+ * 初始化一棵管理`[start,end)`的空区间树，节点从`pool`中分配。
+ */
+void itree_new(itree_t *tree, usize start, usize end, itree_pool_t *pool);
+
+/**
+ * @name itree_insert
+ *
+ * ```c
+ * itree_node_t *itree_insert(itree_t *tree, usize start, usize end, void *data);
+ * ```
+ *
+ * 插入区间`[start,end)`，返回它的节点。
+ * 区间为空、超出树的范围、与已有区间相交或无法分配节点时返回`nullptr`。
+ */
+itree_node_t *itree_insert(itree_t *tree, usize start, usize end, void *data);
+
+/**
+ * @name itree_remove
+ *
+ * ```c
+ * void itree_remove(itree_t *tree, itree_node_t *node);
+ * ```
+ *
+ * 移除区间并把节点归还节点池。
+ */
+void itree_remove(itree_t *tree, itree_node_t *node);
+
+/**
+ * @name itree_find, itree_first_overlap
+ *
+ * ```c
+ * itree_node_t *itree_find(itree_t *tree, usize address);
+ * itree_node_t *itree_first_overlap(itree_t *tree, usize start, usize end);
+ * ```
+ *
+ * `itree_find`返回包含`address`的区间，`itree_first_overlap`返回与`[start,end)`相交的区间中起始地址最小的一个，
+ * 没有时返回`nullptr`。
+ */
+itree_node_t *itree_find(itree_t *tree, usize address);
+itree_node_t *itree_first_overlap(itree_t *tree, usize start, usize end);
+
+/**
+ * @name itree_first, itree_next, itree_prev
+ *
+ * ```c
+ * itree_node_t *itree_first(itree_t *tree);
+ * itree_node_t *itree_next(itree_node_t *node);
+ * itree_node_t *itree_prev(itree_node_t *node);
+ * ```
+ *
+ * 按起始地址顺序遍历区间，没有更多区间时返回`nullptr`。
+ */
+itree_node_t *itree_first(itree_t *tree);
+itree_node_t *itree_next(itree_node_t *node);
+itree_node_t *itree_prev(itree_node_t *node);
+
+/**
+ * @name itree_split
+ *
+ * ```c
+ * itree_node_t *itree_split(itree_t *tree, itree_node_t *node, usize at);
+ * ```
+ *
+ * 在`at`处把区间分为`[start,at)`与`[at,end)`两部分，`node`保留前一部分，返回后一部分的新节点，
+ * 新节点的`data`与`node`相同。`at`不在区间内部或无法分配节点时返回`nullptr`，区间不变。
+ */
+itree_node_t *itree_split(itree_t *tree, itree_node_t *node, usize at);
+
+/**
+ * @name itree_merge
+ *
+ * ```c
+ * bool itree_merge(itree_t *tree, itree_node_t *node);
+ * ```
+ *
+ * 后一个区间紧接`node`时把它并入`node`并移除其节点，返回true。调用者负责在此之前处理后一个区间的`data`。
+ */
+bool itree_merge(itree_t *tree, itree_node_t *node);
+
+/**
+ * @name itree_find_gap
+ *
+ * ```c
+ * bool itree_find_gap(itree_t *tree, usize size, usize align, bool best_fit, usize *address);
+ * ```
+ *
+ * 在树的范围中寻找不与任何区间相交的、按`align`对齐的`size`字节空间，找到时写入`address`并返回true。
+ *
+ * `best_fit`为false时返回地址最低的空间，为true时返回能容纳它的最小空隙中的空间。
+ * 两种方式都跳过最大空隙不足`size`的子树；首次适应在对齐不造成浪费时是O(log n)的，
+ * 最佳适应需要访问所有足够大的空隙，遇到恰好容纳的空隙时提前结束。
+ */
+bool itree_find_gap(itree_t *tree, usize size, usize align, bool best_fit, usize *address);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef LZ4_H
+#define LZ4_H 1
+
+#include <types.h>
+
+/**
+ * @name LZ4_HASH_LOG, LZ4_HASH_SIZE
+ *
+ * 压缩时寻找匹配使用的哈希表有`2^LZ4_HASH_LOG`项，每项2字节。
+ */
+#define LZ4_HASH_LOG 12
+#define LZ4_HASH_SIZE (1 << LZ4_HASH_LOG)
+
+/**
+ * @name LZ4_INPUT_MAX
+ *
+ * 一次压缩的最大输入长度，匹配的偏移与哈希表中的位置都不超过16位。
+ */
+#define LZ4_INPUT_MAX 65535
+
+/**
+ * @name lz4_compress
+ *
+ * ```c
+ * usize lz4_compress(void *source, usize size, void *dest, usize capacity, u16 *table);
+ * ```
+ *
+ * 把`source`开始的`size`字节压缩为LZ4块格式写入`dest`，返回压缩后的长度。
+ * 压缩结果超过`capacity`字节或`size`超过`LZ4_INPUT_MAX`时返回0。
+ *
+ * `table`为调用者提供的`LZ4_HASH_SIZE`项的哈希表，不需要初始化。
+ */
+usize lz4_compress(void *source, usize size, void *dest, usize capacity, u16 *table);
+
+/**
+ * @name lz4_decompress
+ *
+ * ```c
+ * bool lz4_decompress(void *source, usize size, void *dest, usize dest_size);
+ * ```
+ *
+ * 把`source`开始的`size`字节LZ4块解压到`dest`。只有块完整且恰好解压出`dest_size`字节时返回true，
+ * 损坏的输入不会导致越界读写。
+ */
+bool lz4_decompress(void *source, usize size, void *dest, usize dest_size);
+
+#endif
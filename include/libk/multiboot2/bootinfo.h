@@ -301,6 +301,17 @@ typedef struct __bootinfo_efi_system_table_pointer_t
 #define bootinfo_efi_system_table_pointer(addr) (bootinfo_efi_system_table_pointer_t *)(addr)
 #define BOOTINFO_EFI_SYSTEM_TABLE_POINTER_TYPE 12
 
+/** ACPI old RSDP
+ * This tag contains a copy of RSDP as defined per ACPI 1.0 specification.
+ */
+typedef struct __bootinfo_acpi_old_rsdp_t
+{
+    u32 size;
+    u8 acpi_data[0];
+} DISALIGNED bootinfo_acpi_old_rsdp_t;
+#define bootinfo_acpi_old_rsdp(addr) (bootinfo_acpi_old_rsdp_t *)((usize)(addr) - sizeof(u32))
+#define BOOTINFO_ACPI_OLD_RSDP_TYPE 14
+
 /** ACPI v2 RSDP
  * This tag contains a copy of RSDP as defined per ACPI 2.0 or later specification.
  */
@@ -3,8 +3,53 @@
 
 #include <types.h>
 
-extern void memset(void *__dest, u8 __src, usize len);
-extern void memcpy(void *__dest, void *__src, usize len);
+/**
+ * @name memset, memcpy, memmove, memcmp, strlen
+ *
+ * ```c
+ * void *memset(void *__dest, u8 __src, usize len);
+ * void *memcpy(void *__dest, void *__src, usize len);
+ * void *memmove(void *__dest, void *__src, usize len);
+ * int memcmp(void *__s1, void *__s2, usize len);
+ * usize strlen(void *__dest);
+ * ```
+ *
+ * 与C标准库的同名函数相同，`memcpy`的源与目标不能重叠，重叠时使用`memmove`。
+ *
+ * 不超过16字节的`memset`与`memcpy`直接完成，更长的由`string_init`按处理器特性选择实现。
+ *
+ * 只使用通用寄存器，不使用SSE2或AVX2循环。这些函数在`kernel_fpu_init`之前与中断入口程序中也会被调用，
+ * 而在其中进入`kernel_fpu_begin`区间需要XSAVE与XRSTOR所有开启的状态分量（开启AVX-512时约2.7KB）。
+ * 足够长、能抵消这一开销的复制与填充，ERMS或FSRM的`rep movsb`已能达到相同的带宽，超过缓存大小时使用非临时存储。
+ * 需要向量化的调用者在自己的FPU区间中处理数据，见`SIMD_C_SRCS`。
+ */
+extern void *memset(void *__dest, u8 __src, usize len);
+extern void *memcpy(void *__dest, void *__src, usize len);
+extern void *memmove(void *__dest, void *__src, usize len);
+extern int memcmp(void *__s1, void *__s2, usize len);
 extern usize strlen(void *__dest);
 
+/**
+ * @name STRING_xx_THRESHOLD
+ *
+ * * `STRING_ERMS_THRESHOLD`：只支持ERMS时，不小于此大小的复制与填充使用`rep movsb`与`rep stosb`，
+ *   更短时`rep`的启动开销超过8字节循环。支持FSRM时所有长度都使用`rep`。
+ * * `STRING_NT_MIN`：非临时存储阈值的下限。阈值为最后一级缓存大小的3/4，超过时复制与填充不经过缓存，
+ *   避免替换缓存中的数据；无法取得缓存大小时不使用非临时存储。
+ */
+#define STRING_ERMS_THRESHOLD 256
+#define STRING_NT_MIN (256 * 1024)
+
+/**
+ * @name string_init
+ *
+ * ```c
+ * void string_init();
+ * ```
+ *
+ * 通过`cpuid`检测ERMS、FSRM与缓存大小，选择`memcpy`与`memset`的实现。在`kmain`开始时调用一次，
+ * 之前使用8字节循环的实现。
+ */
+void string_init();
+
 #endif
@@ -0,0 +1,86 @@
+#include <kernel/acpi.h>
+#include <kernel/memm.h>
+
+#include <libk/bits.h>
+#include <libk/string.h>
+
+// RSDT或XSDT的物理地址，XSDT中的表项为64位
+static u64 acpi_root = 0;
+static bool acpi_root_extended = false;
+
+void acpi_init(bootinfo_t *bootinfo)
+{
+    void **tags;
+    if (bootinfo_get_tag(bootinfo, BOOTINFO_ACPI_RSDP_TYPE, &tags) != 0)
+    {
+        acpi_rsdp_t *rsdp = (acpi_rsdp_t *)(bootinfo_acpi_rsdp(tags[0]))->acpi_data;
+        if (rsdp->revision >= 2 && rsdp->xsdt_address != 0)
+        {
+            acpi_root = rsdp->xsdt_address;
+            acpi_root_extended = true;
+        }
+        else
+            acpi_root = rsdp->rsdt_address;
+    }
+    else if (bootinfo_get_tag(bootinfo, BOOTINFO_ACPI_OLD_RSDP_TYPE, &tags) != 0)
+    {
+        acpi_rsdp_t *rsdp = (acpi_rsdp_t *)(bootinfo_acpi_old_rsdp(tags[0]))->acpi_data;
+        acpi_root = rsdp->rsdt_address;
+    }
+}
+
+// 把[physical, physical + size)映射到直接映射区域中，固件的表可能位于保留内存中
+static void *acpi_map(u64 physical, usize size)
+{
+    u64 start = physical & ~((u64)MEMM_PAGE_SIZE - 1);
+    u64 end = physical + size;
+    align_to(end, MEMM_PAGE_SIZE);
+    memm_map_pageframes_to(
+        (u64)phys_to_virt(start), start, end - start,
+        false, true, MEMM_MEMORY_TYPE_WB);
+    return phys_to_virt(physical);
+}
+
+static acpi_sdt_header_t *acpi_map_table(u64 physical)
+{
+    acpi_sdt_header_t *header = acpi_map(physical, sizeof(acpi_sdt_header_t));
+    if (header->length < sizeof(acpi_sdt_header_t))
+        return nullptr;
+    return acpi_map(physical, header->length);
+}
+
+static bool acpi_table_valid(acpi_sdt_header_t *table)
+{
+    u8 sum = 0;
+    for (usize i = 0; i < table->length; i++)
+        sum += ((u8 *)table)[i];
+    return sum == 0;
+}
+
+acpi_sdt_header_t *acpi_find_table(const char *signature)
+{
+    if (acpi_root == 0 || !memm_physmap_ready)
+        return nullptr;
+    acpi_sdt_header_t *root = acpi_map_table(acpi_root);
+    if (root == nullptr || !acpi_table_valid(root))
+        return nullptr;
+
+    usize entry_size = acpi_root_extended ? sizeof(u64) : sizeof(u32);
+    usize amount = (root->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    void *entries = (void *)root + sizeof(acpi_sdt_header_t);
+    for (usize i = 0; i < amount; i++)
+    {
+        // XSDT的表项没有按8字节对齐
+        u64 physical = 0;
+        memcpy(&physical, entries + i * entry_size, entry_size);
+        acpi_sdt_header_t *table = acpi_map_table(physical);
+        if (table == nullptr)
+            continue;
+        if (table->signature[0] != signature[0] || table->signature[1] != signature[1] ||
+            table->signature[2] != signature[2] || table->signature[3] != signature[3])
+            continue;
+        if (acpi_table_valid(table))
+            return table;
+    }
+    return nullptr;
+}
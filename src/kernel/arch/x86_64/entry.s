@@ -16,6 +16,8 @@ init64:
 
     ; 加载系统调用相关寄存器
     ; IA32_STAR = 0x0018_0008_0000_0000
+    ; syscall: CS = 0x08, SS = 0x10
+    ; sysret:  CS = 0x18 + 16 = 0x28（64位用户代码段），SS = 0x18 + 8 = 0x20（用户数据段），RPL = 3
     mov rcx, 0xc0000081
     mov rax, 0x0018000800000000
     wrmsr
@@ -103,9 +103,9 @@ gdt:
     dq  0
     dq  0x0020980000000000  ; 内核态代码段
     dq  0x0000920000000000  ; 内核态数据段
-    dq  0x0020f80000000000  ; 用户态代码段
+    dq  0x00cffa000000ffff  ; 用户态32位代码段，sysret返回32位代码时使用
     dq  0x0000f20000000000  ; 用户态数据段
-    dq  0
+    dq  0x0020f80000000000  ; 用户态代码段，sysret返回64位代码时使用
     dq  0x0000891070000068  ; TSS段（低64位）
     dq  0                   ; TSS段（高64位）
 gdt_end:
@@ -0,0 +1,33 @@
+use core::marker::PhantomData;
+
+extern "C" {
+    fn kernel_fpu_begin() -> bool;
+    fn kernel_fpu_end();
+}
+
+/// 可以使用FPU与向量寄存器的区间，`KernelFpu`被丢弃时结束。
+///
+/// rust代码以`-sse`编译，使用向量寄存器的函数标注`#[target_feature(enable = "sse2")]`，
+/// 只在持有`KernelFpu`时调用。`begin`返回`None`时使用标量的实现。
+pub struct KernelFpu {
+    // 区间属于当前处理器的当前中断层
+    _marker: PhantomData<*const ()>,
+}
+
+impl KernelFpu {
+    pub fn begin() -> Option<Self> {
+        if unsafe { kernel_fpu_begin() } {
+            Some(Self {
+                _marker: PhantomData,
+            })
+        } else {
+            None
+        }
+    }
+}
+
+impl Drop for KernelFpu {
+    fn drop(&mut self) {
+        unsafe { kernel_fpu_end() };
+    }
+}
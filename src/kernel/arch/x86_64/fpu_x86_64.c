@@ -0,0 +1,113 @@
+#include <kernel/fpu.h>
+#include <kernel/kernel.h>
+#include <kernel/memm.h>
+
+#include <libk/string.h>
+
+usize kernel_fpu_size = 0;
+
+static kernel_fpu_t kernel_fpu[KERNEL_CPU_MAX];
+static bool xsave_supported = false;
+static bool xsaveopt_supported = false;
+
+void kernel_fpu_init()
+{
+    kernel_fpu_t *fpu = &kernel_fpu[kernel_cpu_id()];
+    u32 regs[4];
+    kernel_cpuid(1, 0, regs);
+    if ((regs[3] & ((u32)1 << 24)) == 0) // CPUID.01H:EDX.FXSR
+        return;
+    xsave_supported = (regs[2] & ((u32)1 << 26)) != 0; // CPUID.01H:ECX.XSAVE
+
+    write_cr0((read_cr0() & ~(KERNEL_CR0_EM | KERNEL_CR0_TS)) | KERNEL_CR0_MP);
+    u64 cr4 = read_cr4() | KERNEL_CR4_OSFXSR | KERNEL_CR4_OSXMMEXCPT;
+    if (xsave_supported)
+        cr4 |= KERNEL_CR4_OSXSAVE;
+    write_cr4(cr4);
+
+    kernel_fpu_size = 512;
+    if (xsave_supported)
+    {
+        // CPUID.(EAX=0DH,ECX=0)中EDX:EAX为支持的状态分量，开启后EBX为保存区的大小
+        kernel_cpuid(0xd, 0, regs);
+        u64 supported = ((u64)regs[3] << 32) | regs[0];
+        u64 xcr0 = KERNEL_XCR0_X87 | KERNEL_XCR0_SSE;
+        if (supported & KERNEL_XCR0_AVX)
+        {
+            xcr0 |= KERNEL_XCR0_AVX;
+            if ((supported & KERNEL_XCR0_AVX512) == KERNEL_XCR0_AVX512)
+                xcr0 |= KERNEL_XCR0_AVX512;
+        }
+        kernel_xsetbv(0, xcr0);
+        kernel_cpuid(0xd, 0, regs);
+        kernel_fpu_size = (regs[1] + 63) & ~(usize)63;
+        kernel_cpuid(0xd, 1, regs);
+        xsaveopt_supported = (regs[0] & 1) != 0; // CPUID.(EAX=0DH,ECX=1):EAX.XSAVEOPT
+    }
+    kernel_fninit();
+
+    u8 *area = memm_kernel_allocate_aligned(kernel_fpu_size * KERNEL_FPU_LEVELS, 64, MEMM_TAG_OTHER);
+    if (area == nullptr)
+        return;
+    // XSAVE只写入头部的XSTATE_BV，XRSTOR要求头部的其它字节为0
+    memset(area, 0, kernel_fpu_size * KERNEL_FPU_LEVELS);
+    fpu->area = area;
+}
+
+bool kernel_fpu_begin()
+{
+    kernel_fpu_t *fpu = &kernel_fpu[kernel_cpu_id()];
+    usize level = fpu->level;
+    if (fpu->area == nullptr || level >= KERNEL_FPU_LEVELS)
+        return false;
+    if ((fpu->saved & ((usize)1 << level)) == 0)
+    {
+        // 保存期间被中断打断时，中断自己保存并恢复寄存器，返回后寄存器的值不变
+        void *area = fpu->area + level * kernel_fpu_size;
+        if (xsaveopt_supported)
+            kernel_xsaveopt(area);
+        else if (xsave_supported)
+            kernel_xsave(area);
+        else
+            kernel_fxsave(area);
+        fpu->saved |= (usize)1 << level;
+    }
+    fpu->nesting[level]++;
+    return true;
+}
+
+static void kernel_fpu_restore(kernel_fpu_t *fpu, usize level)
+{
+    if ((fpu->saved & ((usize)1 << level)) == 0)
+        return;
+    void *area = fpu->area + level * kernel_fpu_size;
+    if (xsave_supported)
+        kernel_xrstor(area);
+    else
+        kernel_fxrstor(area);
+    fpu->saved &= ~((usize)1 << level);
+}
+
+void kernel_fpu_end()
+{
+    kernel_fpu_t *fpu = &kernel_fpu[kernel_cpu_id()];
+    usize level = fpu->level;
+    if (level >= KERNEL_FPU_LEVELS || fpu->nesting[level] == 0)
+        return;
+    // 第0层没有返回点，最外层的区间结束时立即恢复；中断中的状态在中断返回时恢复
+    if (--fpu->nesting[level] == 0 && level == 0)
+        kernel_fpu_restore(fpu, level);
+}
+
+void kernel_fpu_interrupt_enter()
+{
+    kernel_fpu[kernel_cpu_id()].level++;
+}
+
+void kernel_fpu_interrupt_leave()
+{
+    kernel_fpu_t *fpu = &kernel_fpu[kernel_cpu_id()];
+    if (fpu->level < KERNEL_FPU_LEVELS)
+        kernel_fpu_restore(fpu, fpu->level);
+    fpu->level--;
+}
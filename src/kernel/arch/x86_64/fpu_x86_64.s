@@ -0,0 +1,54 @@
+    section .text
+
+    global kernel_xsave
+; void kernel_xsave(void *area)
+kernel_xsave:
+    ; EDX:EAX为全1，保存XCR0中开启的所有分量
+    mov eax, -1
+    mov edx, -1
+    xsave64 [rdi]
+    ret
+
+    global kernel_xsaveopt
+; void kernel_xsaveopt(void *area)
+kernel_xsaveopt:
+    mov eax, -1
+    mov edx, -1
+    xsaveopt64 [rdi]
+    ret
+
+    global kernel_xrstor
+; void kernel_xrstor(void *area)
+kernel_xrstor:
+    mov eax, -1
+    mov edx, -1
+    xrstor64 [rdi]
+    ret
+
+    global kernel_fxsave
+; void kernel_fxsave(void *area)
+kernel_fxsave:
+    fxsave64 [rdi]
+    ret
+
+    global kernel_fxrstor
+; void kernel_fxrstor(void *area)
+kernel_fxrstor:
+    fxrstor64 [rdi]
+    ret
+
+    global kernel_xsetbv
+; void kernel_xsetbv(u32 xcr, u64 value)
+kernel_xsetbv:
+    mov ecx, edi
+    mov eax, esi
+    mov rdx, rsi
+    shr rdx, 32
+    xsetbv
+    ret
+
+    global kernel_fninit
+; void kernel_fninit()
+kernel_fninit:
+    fninit
+    ret
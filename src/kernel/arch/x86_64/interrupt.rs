@@ -6,6 +6,8 @@ extern "C" {
     // 以下两个函数签名的返回值用于使编译器保留rax寄存器
     pub fn interrupt_rust_enter() -> usize;
     pub fn interrupt_rust_leave() -> usize;
+
+    fn memm_handle_page_fault(address: u64, errcode: u64) -> bool;
 }
 
 #[no_mangle]
@@ -46,3 +48,23 @@ unsafe extern "C" fn interrupt_req_BP(rip: u64, rsp: u64, errcode: u64) {}
 
 #[no_mangle]
 unsafe extern "C" fn interrupt_req_OF(rip: u64, rsp: u64, errcode: u64) {}
+
+#[no_mangle]
+unsafe extern "C" fn interrupt_req_PF(rip: u64, rsp: u64, errcode: u64, address: u64) {
+    interrupt_rust_enter();
+    if !memm_handle_page_fault(address, errcode) {
+        let tty = Tty::from_id(0).unwrap();
+        tty.enable();
+        tty.print(message!(
+            "{Panic}: Kernel hit an unhandled {Page Fault} at 0x{} with error code 0x{} on rip=0x{} and rsp=0x{}.\n",
+            FmtMeta::Color(Color::RED),
+            FmtMeta::Color(Color::YELLOW),
+            FmtMeta::Pointer(address as usize),
+            FmtMeta::Pointer(errcode as usize),
+            FmtMeta::Pointer(rip as usize),
+            FmtMeta::Pointer(rsp as usize)
+        ));
+        loop {}
+    }
+    interrupt_rust_leave();
+}
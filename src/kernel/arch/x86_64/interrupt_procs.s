@@ -107,3 +107,19 @@ interrupt_entry_OF:
 
     interrupt_entry_leave
     iretq
+
+    global interrupt_entry_PF
+    extern interrupt_req_PF
+; 带有错误码，CR2在开中断之前读取
+interrupt_entry_PF:
+    interrupt_entry_enter
+
+    mov rdi, [rsp + 136]
+    mov rsi, [rsp + 160]
+    mov rdx, [rsp + 128]
+    mov rcx, cr2
+    call interrupt_req_PF
+
+    interrupt_entry_leave
+    add rsp, 8 ; 错误码
+    iretq
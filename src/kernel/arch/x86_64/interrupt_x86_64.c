@@ -22,6 +22,9 @@ void interrupt_init()
     interrupt_register_gate(gate, 3);
     trap_gate_generate(gate, interrupt_entry_sym(OF));
     interrupt_register_gate(gate, 4);
+    // 使用中断门，保证读取CR2之前不会被其它中断打断
+    interrupt_gate_generate(gate, interrupt_entry_sym(PF));
+    interrupt_register_gate(gate, 14);
 
     interrupt_open();
 }
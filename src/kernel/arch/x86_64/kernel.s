@@ -19,3 +19,79 @@ prepare_stack:
     mov rax, [rax]
     mov [rsp], rax
     ret
+
+    global kernel_cpuid
+kernel_cpuid:
+    push rbx
+
+    mov r8, rdx
+    mov eax, edi
+    mov ecx, esi
+    cpuid
+    mov [r8], eax
+    mov [r8 + 4], ebx
+    mov [r8 + 8], ecx
+    mov [r8 + 12], edx
+
+    pop rbx
+    ret
+
+    global kernel_apic_id
+kernel_apic_id:
+    push rbx
+
+    mov eax, 1
+    cpuid
+    mov eax, ebx
+    shr eax, 24
+
+    pop rbx
+    ret
+
+    global kernel_rdtsc
+kernel_rdtsc:
+    push rdx
+
+    rdtsc
+    shl rdx, 32
+    or rax, rdx
+
+    pop rdx
+    ret
+
+    global read_cr0
+read_cr0:
+    mov rax, cr0
+    ret
+
+    global write_cr0
+write_cr0:
+    mov cr0, rdi
+    ret
+
+    global read_cr4
+read_cr4:
+    mov rax, cr4
+    ret
+
+    global write_cr4
+write_cr4:
+    mov cr4, rdi
+    ret
+
+    global read_msr
+read_msr:
+    mov ecx, edi
+    rdmsr
+    shl rdx, 32
+    or rax, rdx
+    ret
+
+    global write_msr
+write_msr:
+    mov ecx, edi
+    mov rax, rsi
+    mov rdx, rsi
+    shr rdx, 32
+    wrmsr
+    ret
@@ -2,135 +2,1189 @@
 
 #include <kernel/memm.h>
 
+#include <kernel/kernel.h>
+
 #include <libk/string.h>
 #include <libk/math.h>
 
-#define map_pagemap(addr) \
-    map_pageframe_to((u64)addr, (u64)addr, false, true, MEMM_PAGE_SIZE_4K);
+memm_address_space_t memm_kernel_address_space = {
+    .pml4 = PML4,
+    .pcid = 0,
+    .stale = false,
+    .next = nullptr,
+};
 
-// 这里的physical必须保证根据ps对齐
-static void map_pageframe_to(
-    u64 target, u64 physical,
-    bool user, bool write, memm_page_size ps)
+static memm_address_space_t *current_space = &memm_kernel_address_space;
+
+bool memm_physmap_ready = false;
+bool memm_1g_page_supported = false;
+
+memm_page_counter memm_page_counters;
+
+static bool pcid_enabled = false;
+static bool invpcid_supported = false;
+
+// 按最近使用的顺序排列的PCID链表，PCID 0不在链表中
+static memm_address_space_t *pcid_owner[MEMM_PCID_AMOUNT];
+static u16 pcid_prev[MEMM_PCID_AMOUNT], pcid_next[MEMM_PCID_AMOUNT];
+static u16 pcid_head, pcid_tail;
+
+// 每个处理器的翻译缓存，项缓存一个叶子页表项，level为它所在页表的级别
+// space为nullptr表示内核空间的项，generation与translation_generation不同的项无效
+typedef struct
 {
-    if (!is_cannonical(target))
+    u64 page;
+    u64 entry;
+    memm_address_space_t *space;
+    usize level;
+    usize generation;
+} translation_cache_entry_t;
+
+static translation_cache_entry_t translation_cache[KERNEL_CPU_MAX][MEMM_TRANSLATION_CACHE_SIZE];
+static usize translation_generation = 1;
+
+// address所在的level级页在翻译缓存中的位置
+#define translation_slot(address, level)                                       \
+    ((((address) >> (MEMM_LA_PEI_OFFSET + 9 * ((level) - 1))) + (level)) & \
+     (MEMM_TRANSLATION_CACHE_SIZE - 1))
+
+// 叶子页表项映射的页框地址与页的阶，level为页表项所在页表的级别，PT为1
+#define leaf_address(entry, level) \
+    ((level) == 1 ? memm_pte_get_address(entry) : ((entry) & MEMM_BP_ENTRY_ADDRESS_MASK))
+#define leaf_order(level) (9 * ((level) - 1))
+
+static inline bool frame_is_anonymous(u64 physical)
+{
+    memm_frame_t *frame = memm_frame_get(physical);
+    return frame != nullptr && (frame->flags & MEMM_FRAME_FLAG_ANONYMOUS);
+}
+
+// 放弃对共享页框的一份引用，最后一个共享者释放页框
+static void shared_release(u64 entry, usize level)
+{
+    u64 address = leaf_address(entry, level);
+    memm_frame_t *frame = memm_frame_get(address);
+    if (frame == nullptr)
         return;
+    if (frame->refcount > 1)
+        frame->refcount--;
+    else
+    {
+        frame->refcount = 0;
+        memm_free_pages(address, leaf_order(level), 0);
+    }
+}
 
-    usize pml4ei = memm_la_get_entry_index(target, MEMM_LA_PML4EI);
-    usize pml4e = PML4[pml4ei];
-    u64 *PDPT;
-    if (memm_entry_flag_get(pml4e, MEMM_ENTRY_FLAG_PRESENT) == true)
-        PDPT = (u64 *)memm_entry_get_address(pml4e);
+// 取消映射一个叶子页表项时释放它对页框的所有权：共享的页框减少共享数量，匿名页框（包括合并出的2MB页）被释放
+static void leaf_release(u64 entry, usize level)
+{
+    if (memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_SHARED))
+    {
+        shared_release(entry, level);
+        return;
+    }
+    u64 address = leaf_address(entry, level);
+    if (frame_is_anonymous(address))
+        memm_free_pages(address, leaf_order(level), 0);
+}
+
+// 把共享的叶子页表项改为私有的，页框仍被其它地址空间共享时复制一份，写时复制页同时恢复为可写
+// 私有的匿名页重新放入LRU链表
+static bool unshare_page(u64 *entry, usize level, u64 page, memm_tlb_batch_t *batch)
+{
+    u64 address = leaf_address(*entry, level);
+    memm_frame_t *frame = memm_frame_get(address);
+    bool anonymous = frame != nullptr && (frame->flags & MEMM_FRAME_FLAG_ANONYMOUS);
+    if (frame != nullptr && frame->refcount > 1)
+    {
+        usize order = leaf_order(level);
+        u64 copy = memm_alloc_pages(order, 0);
+        if (copy == 0)
+            return false;
+        memcpy(phys_to_virt(copy), phys_to_virt(address), (usize)MEMM_PAGE_SIZE << order);
+        frame->refcount--;
+        if (anonymous && level != 1)
+            memm_frame_get(copy)->flags |= MEMM_FRAME_FLAG_ANONYMOUS;
+        // 副本的内容不一定是全0的，不能作为没有被写入过的页回收
+        address = copy;
+        *entry = (*entry & ~(level == 1 ? MEMM_ENTRY_ADDRESS_MASK : MEMM_BP_ENTRY_ADDRESS_MASK)) |
+                 copy | MEMM_ENTRY_FLAG_DIRTY;
+    }
+    else if (frame != nullptr)
+        frame->refcount = 0;
+    if (anonymous && level == 1)
+        memm_lru_add(address, is_user_address(page) ? batch->space : &memm_kernel_address_space, page);
+    if (memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_COW))
+        *entry |= MEMM_ENTRY_FLAG_WRITE;
+    *entry &= ~(MEMM_ENTRY_FLAG_SHARED | MEMM_ENTRY_FLAG_COW);
+    memm_tlb_batch_add(batch, page, MEMM_PAGE_SIZE);
+    return true;
+}
+
+// 释放页表table及其下级页表，level为table的级别，PT为1，PDT为2，PDPT为3
+static void free_pagetable_tree(u64 *table, usize level)
+{
+    for (usize i = 0; i < 512; i++)
+    {
+        if (!memm_entry_flag_get(table[i], MEMM_ENTRY_FLAG_PRESENT))
+        {
+            if (level == 1 && memm_entry_flag_get(table[i], MEMM_ENTRY_FLAG_SWAP))
+                memm_zram_put(memm_swap_entry_get(table[i]));
+            continue;
+        }
+        if (level == 1 || memm_entry_flag_get(table[i], MEMM_ENTRY_FLAG_PS))
+            leaf_release(table[i], level);
+        else
+            free_pagetable_tree((u64 *)phys_to_virt(memm_entry_get_address(table[i])), level - 1);
+    }
+    memm_free_pagetable(table);
+}
+
+// 把映射大小为ps的大型页的页表项拆分为下一级页表，下一级页表映射相同的地址与属性
+// 共享的大型页先变为私有的，address为大型页中的任意地址
+// 匿名的2MB页拆分为512个匿名页框并放入LRU链表
+static u64 *split_large_page(u64 *entry, memm_page_size ps, u64 address, memm_tlb_batch_t *batch)
+{
+    if (memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_SHARED) &&
+        !unshare_page(
+            entry, ps == MEMM_PAGE_SIZE_2M ? 2 : 3,
+            address & ~((u64)ps * MEMM_PAGE_SIZE - 1), batch))
+        return nullptr;
+    u64 *table = memm_allcate_pagetable();
+    if (table == nullptr)
+        return nullptr;
+    u64 physical = *entry & MEMM_BP_ENTRY_ADDRESS_MASK;
+    u64 flags = *entry & (MEMM_PAGE_TABLE_FLAGS_MASK | MEMM_ENTRY_FLAG_XD);
+    if (ps == MEMM_PAGE_SIZE_2M)
+    { // pte中没有PS位，PAT位在PS的位置
+        flags &= ~MEMM_ENTRY_FLAG_PS;
+        if (*entry & MEMM_ENTRY_FLAG_PAT)
+            flags |= MEMM_PTE_ENTRY_FLAG_PAT;
+    }
     else
+        flags |= *entry & MEMM_ENTRY_FLAG_PAT;
+    usize step = (usize)ps / 512 * MEMM_PAGE_SIZE;
+    for (usize i = 0; i < 512; i++)
+        table[i] = (physical + i * step) | flags;
+    *entry =
+        MEMM_ENTRY_FLAG_PRESENT |
+        MEMM_ENTRY_FLAG_WRITE |
+        (*entry & MEMM_ENTRY_FLAG_USER) |
+        virt_to_phys(table);
+    if (ps == MEMM_PAGE_SIZE_2M)
     {
-        PDPT = memm_allcate_pagetable();
-        map_pagemap(PDPT);
-        memset(PDPT, 0, MEMM_PAGE_SIZE);
+        memm_page_counters.demoted_2m_page++;
+        if (frame_is_anonymous(physical))
+        {
+            u64 page = address & ~((u64)ps * MEMM_PAGE_SIZE - 1);
+            memm_address_space_t *space = is_user_address(page) ? batch->space : &memm_kernel_address_space;
+            for (usize i = 0; i < 512; i++)
+                memm_lru_add(physical + i * step, space, page + i * step);
+        }
+    }
+    else
+        memm_page_counters.demoted_1g_page++;
+    return table;
+}
 
-        PML4[pml4ei] =
-            MEMM_ENTRY_FLAG_PRESENT |
-            MEMM_ENTRY_FLAG_WRITE |
-            (u64)PDPT;
+// 取得页表项entry指向的下一级页表，不存在时创建，为大型页时拆分
+static u64 *next_table(u64 *entry, memm_page_size ps, u64 target, memm_tlb_batch_t *batch)
+{
+    if (memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_PRESENT) == true)
+    {
+        if (memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_PS) == true)
+            return split_large_page(entry, ps, target, batch);
+        return (u64 *)phys_to_virt(memm_entry_get_address(*entry));
+    }
+    u64 *table = memm_allcate_pagetable();
+    if (table == nullptr)
+        return nullptr;
+    *entry =
+        MEMM_ENTRY_FLAG_PRESENT |
+        MEMM_ENTRY_FLAG_WRITE |
+        virt_to_phys(table);
+    return table;
+}
+
+// 这里的physical必须保证根据ps对齐
+static bool map_pageframe_to(
+    u64 target, u64 physical,
+    bool user, bool write, memm_page_size ps,
+    memm_memory_type type,
+    memm_tlb_batch_t *batch)
+{
+    if (!is_cannonical(target))
+        return false;
+
+    u64 *pml4 = batch->space->pml4;
+    usize pml4ei = memm_la_get_entry_index(target, MEMM_LA_PML4EI);
+    bool present = memm_entry_flag_get(pml4[pml4ei], MEMM_ENTRY_FLAG_PRESENT);
+    u64 *PDPT = next_table(&pml4[pml4ei], 0, target, batch);
+    if (PDPT == nullptr)
+        return false;
+    if (!present && !is_user_address(target))
+    { // 内核空间新增的PML4项同步到所有地址空间
+        for (memm_address_space_t *space = &memm_kernel_address_space; space != nullptr; space = space->next)
+            space->pml4[pml4ei] = pml4[pml4ei];
     }
 
     usize pdptei = memm_la_get_entry_index(target, MEMM_LA_PDPTEI);
     if (ps == MEMM_PAGE_SIZE_1G)
     {
+        u64 pdpte = PDPT[pdptei];
+        if (memm_entry_flag_get(pdpte, MEMM_ENTRY_FLAG_PRESENT))
+        {
+            if (memm_entry_flag_get(pdpte, MEMM_ENTRY_FLAG_PS))
+            {
+                leaf_release(pdpte, 3);
+                memm_tlb_batch_add(batch, target, MEMM_PAGE_SIZE);
+            }
+            else
+            {
+                free_pagetable_tree((u64 *)phys_to_virt(memm_entry_get_address(pdpte)), 2);
+                memm_tlb_batch_add(batch, target, (usize)MEMM_PAGE_SIZE_1G * MEMM_PAGE_SIZE);
+            }
+        }
         PDPT[pdptei] =
             MEMM_ENTRY_FLAG_PRESENT |
             (write ? MEMM_ENTRY_FLAG_WRITE : 0) |
             (is_user_address(target) ? MEMM_ENTRY_FLAG_USER : 0) |
             MEMM_ENTRY_FLAG_PS |
+            memm_memory_type_flags(type, true) |
             (is_user_address(target) ? 0 : MEMM_ENTRY_FLAG_GLOBAL) |
             physical;
-        return;
-    }
-    usize pdpte = PDPT[pdptei];
-    u64 *PDT;
-    if (memm_entry_flag_get(pdpte, MEMM_ENTRY_FLAG_PRESENT) == true)
-        PDT = (u64 *)memm_entry_get_address(pdpte);
-    else
-    {
-        PDT = memm_allcate_pagetable();
-        map_pagemap(PDT);
-        memset(PDT, 0, MEMM_PAGE_SIZE);
-
-        PDPT[pdptei] =
-            MEMM_ENTRY_FLAG_PRESENT |
-            MEMM_ENTRY_FLAG_WRITE |
-            (u64)PDT;
+        return true;
     }
+    u64 *PDT = next_table(&PDPT[pdptei], MEMM_PAGE_SIZE_1G, target, batch);
+    if (PDT == nullptr)
+        return false;
 
     usize pdei = memm_la_get_entry_index(target, MEMM_LA_PDEI);
     if (ps == MEMM_PAGE_SIZE_2M)
     {
+        u64 pde = PDT[pdei];
+        if (memm_entry_flag_get(pde, MEMM_ENTRY_FLAG_PRESENT))
+        {
+            if (memm_entry_flag_get(pde, MEMM_ENTRY_FLAG_PS))
+            {
+                leaf_release(pde, 2);
+                memm_tlb_batch_add(batch, target, MEMM_PAGE_SIZE);
+            }
+            else
+            {
+                free_pagetable_tree((u64 *)phys_to_virt(memm_entry_get_address(pde)), 1);
+                memm_tlb_batch_add(batch, target, (usize)MEMM_PAGE_SIZE_2M * MEMM_PAGE_SIZE);
+            }
+        }
         PDT[pdei] =
             MEMM_ENTRY_FLAG_PRESENT |
             (write ? MEMM_ENTRY_FLAG_WRITE : 0) |
             (is_user_address(target) ? MEMM_ENTRY_FLAG_USER : 0) |
             MEMM_ENTRY_FLAG_PS |
+            memm_memory_type_flags(type, true) |
             (is_user_address(target) ? 0 : MEMM_ENTRY_FLAG_GLOBAL) |
             physical;
-        return;
-    }
-    usize pde = PDT[pdei];
-    u64 *PT;
-    if (memm_entry_flag_get(pde, MEMM_ENTRY_FLAG_PRESENT) == true)
-        PT = (u64 *)memm_entry_get_address(pde);
-    else
-    {
-        PT = memm_allcate_pagetable();
-        map_pagemap(PT);
-        memset(PT, 0, MEMM_PAGE_SIZE);
-
-        PDT[pdei] =
-            MEMM_ENTRY_FLAG_PRESENT |
-            MEMM_ENTRY_FLAG_WRITE |
-            (u64)PT;
+        return true;
     }
+    u64 *PT = next_table(&PDT[pdei], MEMM_PAGE_SIZE_2M, target, batch);
+    if (PT == nullptr)
+        return false;
 
     usize pei = memm_la_get_entry_index(target, MEMM_LA_PEI);
+    if (memm_entry_flag_get(PT[pei], MEMM_ENTRY_FLAG_PRESENT))
+    {
+        leaf_release(PT[pei], 1);
+        memm_tlb_batch_add(batch, target, MEMM_PAGE_SIZE);
+    }
+    else if (memm_entry_flag_get(PT[pei], MEMM_ENTRY_FLAG_SWAP))
+        memm_zram_put(memm_swap_entry_get(PT[pei]));
     PT[pei] =
         MEMM_ENTRY_FLAG_PRESENT |
         (write ? MEMM_ENTRY_FLAG_WRITE : 0) |
         (is_user_address(target) ? MEMM_ENTRY_FLAG_USER : 0) |
-        MEMM_ENTRY_FLAG_PS |
+        memm_memory_type_flags(type, false) |
         (is_user_address(target) ? 0 : MEMM_ENTRY_FLAG_GLOBAL) |
         physical;
-    return;
+    return true;
 }
 
 bool memm_map_pageframes_to(
     u64 target, u64 physical,
     usize size,
-    bool user, bool write)
+    bool user, bool write,
+    memm_memory_type type)
 {
     if (!is_cannonical(target) || !is_cannonical(physical))
         return false;
     if (!is_aligned(target, MEMM_PAGE_SIZE) || !is_aligned(physical, MEMM_PAGE_SIZE))
         return false;
+    bool res = true;
+    memm_tlb_batch_t batch = {.space = current_space, .amount = 0, .flush_all = false};
     while (size != 0)
     {
-        memm_page_size align = memm_get_page_align(physical);
+        memm_page_size align = memm_get_page_align(target | physical);
         if (align == MEMM_PAGE_SIZE_1G)
         {
-            if (size < (usize)align * MEMM_PAGE_SIZE / 2)
-                align = MEMM_2M_ALIGN_MASK + 1;
+            if (!memm_1g_page_supported || size < (usize)align * MEMM_PAGE_SIZE / 2)
+                align = MEMM_PAGE_SIZE_2M;
         }
         if (align == MEMM_PAGE_SIZE_2M)
         {
             if (size < (usize)align * MEMM_PAGE_SIZE / 2)
-                align = MEMM_4K_ALIGN_MASK + 1;
+                align = MEMM_PAGE_SIZE_4K;
         }
-        align /= MEMM_PAGE_SIZE;
 
-        map_pageframe_to(target, physical, user, write, align);
+        if (!map_pageframe_to(target, physical, user, write, align, type, &batch))
+        {
+            res = false;
+            break;
+        }
 
         usize step = min(size, (usize)align * MEMM_PAGE_SIZE);
         size -= step;
         target += step;
         physical += step;
     }
-    reload_pml4();
+    memm_tlb_batch_flush(&batch);
+    return res;
+}
+
+static bool pagetable_empty(u64 *table)
+{
+    for (usize i = 0; i < 512; i++)
+        if (table[i] != 0)
+            return false;
     return true;
 }
+
+// 在level级页表table中取消映射或修改[start, end)的属性，PT为1，PML4为4
+static bool update_range(
+    u64 *table, usize level,
+    u64 start, u64 end,
+    bool unmap, bool write,
+    memm_tlb_batch_t *batch)
+{
+    usize shift = MEMM_LA_PEI_OFFSET + 9 * (level - 1);
+    u64 entry_size = (u64)1 << shift;
+    u64 addr = start;
+    while (addr < end)
+    {
+        u64 next = (addr | (entry_size - 1)) + 1;
+        if (next > end || next == 0)
+            next = end;
+        u64 *entry = &table[(addr >> shift) & 511];
+        if (!memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_PRESENT))
+        {
+            if (level == 1 && memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_SWAP))
+            { // 换出的页
+                if (unmap)
+                {
+                    memm_zram_put(memm_swap_entry_get(*entry));
+                    *entry = 0;
+                }
+                else if (write)
+                    *entry |= MEMM_ENTRY_FLAG_WRITE;
+                else
+                    *entry &= ~MEMM_ENTRY_FLAG_WRITE;
+            }
+            addr = next;
+            continue;
+        }
+        bool leaf = level == 1 || memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_PS);
+        if (leaf && next - addr == entry_size)
+        { // 覆盖了整个页
+            if (unmap)
+            {
+                leaf_release(*entry, level);
+                *entry = 0;
+            }
+            else if (!write)
+                *entry &= ~(MEMM_ENTRY_FLAG_WRITE | MEMM_ENTRY_FLAG_COW);
+            else if (memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_SHARED))
+                // 共享的页在写入时才复制
+                *entry |= MEMM_ENTRY_FLAG_COW;
+            else
+                *entry |= MEMM_ENTRY_FLAG_WRITE;
+            memm_tlb_batch_add(batch, addr, MEMM_PAGE_SIZE);
+            addr = next;
+            continue;
+        }
+        if (leaf &&
+            split_large_page(
+                entry, level == 2 ? MEMM_PAGE_SIZE_2M : MEMM_PAGE_SIZE_1G,
+                addr, batch) == nullptr)
+            return false;
+        u64 *sub = (u64 *)phys_to_virt(memm_entry_get_address(*entry));
+        if (!update_range(sub, level - 1, addr, next, unmap, write, batch))
+            return false;
+        // 内核空间的PDPT被所有地址空间共享，不回收
+        if (unmap && (level < 4 || is_user_address(addr)) && pagetable_empty(sub))
+        {
+            *entry = 0;
+            memm_free_pagetable(sub);
+            memm_tlb_batch_add(batch, addr, MEMM_PAGE_SIZE);
+        }
+        addr = next;
+    }
+    return true;
+}
+
+static bool update_pageframes(memm_address_space_t *space, u64 target, usize size, bool unmap, bool write)
+{
+    if (!is_cannonical(target) || !is_cannonical(target + size - 1) || target + size < target)
+        return false;
+    if (!is_aligned(target, MEMM_PAGE_SIZE) || !is_aligned(size, MEMM_PAGE_SIZE))
+        return false;
+    memm_tlb_batch_t batch = {.space = space, .amount = 0, .flush_all = false};
+    bool res = update_range(batch.space->pml4, 4, target, target + size, unmap, write, &batch);
+    memm_tlb_batch_flush(&batch);
+    return res;
+}
+
+bool memm_unmap_pageframes(u64 target, usize size)
+{
+    return update_pageframes(current_space, target, size, true, false);
+}
+
+bool memm_protect_pageframes(u64 target, usize size, bool write)
+{
+    return update_pageframes(current_space, target, size, false, write);
+}
+
+bool memm_space_unmap_pageframes(memm_address_space_t *space, u64 target, usize size)
+{
+    return update_pageframes(space, target, size, true, false);
+}
+
+bool memm_space_protect_pageframes(memm_address_space_t *space, u64 target, usize size, bool write)
+{
+    return update_pageframes(space, target, size, false, write);
+}
+
+void memm_tlb_batch_add(memm_tlb_batch_t *batch, u64 address, usize size)
+{
+    if (batch->flush_all)
+        return;
+    usize pages = (size + MEMM_PAGE_SIZE - 1) / MEMM_PAGE_SIZE;
+    if (pages > MEMM_TLB_FLUSH_THRESHOLD - batch->amount)
+    {
+        batch->flush_all = true;
+        return;
+    }
+    usize amount = batch->amount;
+    for (usize i = 0; i < pages; i++)
+        batch->address[amount + i] = address + i * MEMM_PAGE_SIZE;
+    batch->amount = amount + pages;
+}
+
+// 使所有处理器的翻译缓存中可能包含address的项失效
+static void translation_invalidate(u64 address)
+{
+    for (usize cpu = 0; cpu < KERNEL_CPU_MAX; cpu++)
+        for (usize level = 1; level <= 3; level++)
+            translation_cache[cpu][translation_slot(address, level)].generation = 0;
+}
+
+void memm_tlb_batch_flush(memm_tlb_batch_t *batch)
+{
+    if (!batch->flush_all && batch->amount == 0)
+        return;
+    if (batch->flush_all)
+        translation_generation++;
+    else
+        for (usize i = 0; i < batch->amount; i++)
+            translation_invalidate(batch->address[i]);
+    memm_address_space_t *space = batch->space;
+    if (pcid_enabled && memm_get_manager()->page_table_pool.pending != nullptr)
+        // 其它PCID的页表结构缓存也可能引用被归还的页表页
+        flush_tlb();
+    else if (space == current_space)
+    {
+        if (batch->flush_all)
+            flush_tlb();
+        else
+            for (usize i = 0; i < batch->amount; i++)
+                invalidate_page(batch->address[i]);
+    }
+    else if (pcid_enabled && pcid_owner[space->pcid] == space)
+    { // 没有PCID或没有开启PCID的地址空间在切换时总会被刷新
+        if (!invpcid_supported)
+            space->stale = true;
+        else if (batch->flush_all)
+            invpcid(MEMM_INVPCID_CONTEXT, space->pcid, 0);
+        else
+            for (usize i = 0; i < batch->amount; i++)
+                invpcid(MEMM_INVPCID_ADDRESS, space->pcid, batch->address[i]);
+    }
+    memm_pagetable_flushed();
+    batch->amount = 0;
+    batch->flush_all = false;
+}
+
+static inline void pcid_lru_remove(u16 pcid)
+{
+    if (pcid_prev[pcid] != 0)
+        pcid_next[pcid_prev[pcid]] = pcid_next[pcid];
+    else
+        pcid_head = pcid_next[pcid];
+    if (pcid_next[pcid] != 0)
+        pcid_prev[pcid_next[pcid]] = pcid_prev[pcid];
+    else
+        pcid_tail = pcid_prev[pcid];
+}
+
+static inline void pcid_lru_push_front(u16 pcid)
+{
+    pcid_prev[pcid] = 0;
+    pcid_next[pcid] = pcid_head;
+    if (pcid_head != 0)
+        pcid_prev[pcid_head] = pcid;
+    else
+        pcid_tail = pcid;
+    pcid_head = pcid;
+}
+
+// 把最近最少使用的PCID分配给space，原来的所有者失去它的PCID
+static void pcid_assign(memm_address_space_t *space)
+{
+    u16 pcid = pcid_tail;
+    if (pcid_owner[pcid] != nullptr)
+        pcid_owner[pcid]->pcid = 0;
+    pcid_owner[pcid] = space;
+    space->pcid = pcid;
+    pcid_lru_remove(pcid);
+    pcid_lru_push_front(pcid);
+}
+
+void memm_address_space_init()
+{
+    // 内核空间的页都设置了全局位
+    write_cr4(read_cr4() | KERNEL_CR4_PGE);
+    // 内核写入写时复制的只读页时也要进入缺页异常复制私有的页
+    write_cr0(read_cr0() | KERNEL_CR0_WP);
+
+    u32 regs[4];
+    kernel_cpuid(1, 0, regs);
+    if (regs[3] & ((u32)1 << 16)) // CPUID.01H:EDX.PAT
+    {
+        write_msr(MEMM_MSR_IA32_PAT, MEMM_PAT_VALUE);
+        flush_tlb();
+    }
+
+    kernel_cpuid(0x80000000, 0, regs);
+    if (regs[0] >= 0x80000001)
+    {
+        kernel_cpuid(0x80000001, 0, regs);
+        memm_1g_page_supported = (regs[3] & ((u32)1 << 26)) != 0; // CPUID.80000001H:EDX.Page1GB
+    }
+
+    kernel_cpuid(1, 0, regs);
+    if ((regs[2] & ((u32)1 << 17)) == 0) // CPUID.01H:ECX.PCID
+        return;
+    kernel_cpuid(0, 0, regs);
+    if (regs[0] >= 7)
+    {
+        kernel_cpuid(7, 0, regs);
+        invpcid_supported = (regs[1] & ((u32)1 << 10)) != 0; // CPUID.(EAX=07H,ECX=0):EBX.INVPCID
+    }
+
+    pcid_owner[0] = &memm_kernel_address_space;
+    pcid_head = pcid_tail = 0;
+    for (u16 pcid = MEMM_PCID_AMOUNT - 1; pcid != 0; pcid--)
+    {
+        pcid_owner[pcid] = nullptr;
+        pcid_lru_push_front(pcid);
+    }
+    // 开启PCIDE时CR3的低12位必须为0，内核地址空间使用PCID 0
+    write_cr4(read_cr4() | KERNEL_CR4_PCIDE);
+    pcid_enabled = true;
+}
+
+bool memm_address_space_new(memm_address_space_t *space)
+{
+    u64 *pml4 = memm_allcate_pagetable();
+    if (pml4 == nullptr)
+        return false;
+    // 低地址的一半为内核空间
+    memcpy(pml4, memm_kernel_address_space.pml4, 256 * sizeof(u64));
+    space->pml4 = pml4;
+    space->pcid = 0;
+    space->stale = false;
+    space->next = memm_kernel_address_space.next;
+    memm_kernel_address_space.next = space;
+    memm_user_space_init(space);
+    return true;
+}
+
+// 复制level级页表source，共享其中映射的页框，可写的页在两边都改为写时复制页
+static u64 *clone_table(u64 *source, usize level, memm_tlb_batch_t *batch)
+{
+    u64 *table = memm_allcate_pagetable();
+    if (table == nullptr)
+        return nullptr;
+    for (usize i = 0; i < 512; i++)
+    {
+        if (!memm_entry_flag_get(source[i], MEMM_ENTRY_FLAG_PRESENT))
+        { // 换出的页由两个地址空间分别换入
+            if (level == 1 && memm_entry_flag_get(source[i], MEMM_ENTRY_FLAG_SWAP))
+            {
+                memm_zram_get(memm_swap_entry_get(source[i]));
+                table[i] = source[i];
+            }
+            continue;
+        }
+        if (level == 3 && memm_entry_flag_get(source[i], MEMM_ENTRY_FLAG_PS) &&
+            split_large_page(&source[i], MEMM_PAGE_SIZE_1G, 0, batch) == nullptr)
+        {
+            free_pagetable_tree(table, level);
+            return nullptr;
+        }
+        u64 entry = source[i];
+        if (level != 1 && !memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PS))
+        {
+            u64 *sub = clone_table((u64 *)phys_to_virt(memm_entry_get_address(entry)), level - 1, batch);
+            if (sub == nullptr)
+            {
+                free_pagetable_tree(table, level);
+                return nullptr;
+            }
+            table[i] = (entry & ~MEMM_ENTRY_ADDRESS_MASK) | virt_to_phys(sub);
+            continue;
+        }
+        memm_frame_t *frame = memm_frame_get(leaf_address(entry, level));
+        if (frame != nullptr)
+        { // 不由页框分配器管理的内存直接共享
+            if (memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_SHARED))
+                frame->refcount++;
+            else
+                frame->refcount = 2;
+            // 共享期间不能回收
+            memm_lru_del(leaf_address(entry, level));
+            entry |= MEMM_ENTRY_FLAG_SHARED;
+            if (memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_WRITE))
+                entry = (entry & ~MEMM_ENTRY_FLAG_WRITE) | MEMM_ENTRY_FLAG_COW;
+            source[i] = entry;
+        }
+        table[i] = entry;
+    }
+    return table;
+}
+
+bool memm_address_space_clone(memm_address_space_t *space, memm_address_space_t *source)
+{
+    if (!memm_address_space_new(space))
+        return false;
+    if (!memm_user_space_clone(space, source))
+    {
+        memm_address_space_destruct(space);
+        return false;
+    }
+    // 源地址空间中的可写页都改为了只读
+    memm_tlb_batch_t batch = {.space = source, .amount = 0, .flush_all = true};
+    bool res = true;
+    for (usize i = 256; i < 512; i++)
+    {
+        u64 entry = source->pml4[i];
+        if (!memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PRESENT))
+            continue;
+        u64 *PDPT = clone_table((u64 *)phys_to_virt(memm_entry_get_address(entry)), 3, &batch);
+        if (PDPT == nullptr)
+        {
+            res = false;
+            break;
+        }
+        space->pml4[i] = (entry & ~MEMM_ENTRY_ADDRESS_MASK) | virt_to_phys(PDPT);
+    }
+    memm_tlb_batch_flush(&batch);
+    if (!res)
+        memm_address_space_destruct(space);
+    return res;
+}
+
+void memm_address_space_destruct(memm_address_space_t *space)
+{
+    if (space == &memm_kernel_address_space || space == current_space)
+        return;
+    for (memm_address_space_t *it = &memm_kernel_address_space; it != nullptr; it = it->next)
+    {
+        if (it->next == space)
+        {
+            it->next = space->next;
+            break;
+        }
+    }
+    if (pcid_enabled && space->pcid != 0 && pcid_owner[space->pcid] == space)
+    { // 归还的PCID最先被再次分配
+        pcid_owner[space->pcid] = nullptr;
+        pcid_lru_remove(space->pcid);
+        pcid_prev[space->pcid] = pcid_tail;
+        pcid_next[space->pcid] = 0;
+        if (pcid_tail != 0)
+            pcid_next[pcid_tail] = space->pcid;
+        else
+            pcid_head = space->pcid;
+        pcid_tail = space->pcid;
+    }
+    for (usize i = 256; i < 512; i++)
+    {
+        if (memm_entry_flag_get(space->pml4[i], MEMM_ENTRY_FLAG_PRESENT))
+            free_pagetable_tree((u64 *)phys_to_virt(memm_entry_get_address(space->pml4[i])), 3);
+    }
+    memm_free_pagetable(space->pml4);
+    memm_user_space_destruct(space);
+    // 新的地址空间可能使用相同的地址
+    translation_generation++;
+    // 这个地址空间不是当前地址空间，但其它PCID的页表结构缓存仍可能引用这些页表页
+    if (pcid_enabled)
+        flush_tlb();
+    memm_pagetable_flushed();
+}
+
+void memm_address_space_switch(memm_address_space_t *space)
+{
+    u64 cr3 = virt_to_phys(space->pml4);
+    if (pcid_enabled)
+    {
+        if (space != &memm_kernel_address_space)
+        {
+            if (space->pcid == 0 || pcid_owner[space->pcid] != space)
+            { // 新分配的PCID中可能有前一个所有者的TLB项
+                pcid_assign(space);
+                space->stale = true;
+            }
+            else
+            {
+                pcid_lru_remove(space->pcid);
+                pcid_lru_push_front(space->pcid);
+            }
+        }
+        cr3 |= space->pcid;
+        if (!space->stale)
+            cr3 |= MEMM_CR3_NOFLUSH;
+    }
+    space->stale = false;
+    current_space = space;
+    write_cr3(cr3);
+}
+
+memm_address_space_t *memm_current_address_space()
+{
+    return current_space;
+}
+
+// 内核空间的页通过当前地址空间访问，其中的全局页也只能通过当前地址空间的invlpg刷新
+#define page_space(space, address) (is_user_address(address) ? (space) : current_space)
+
+// 取得space中address所在4KB页的pte，所在位置没有PT时返回nullptr
+static u64 *find_pte(memm_address_space_t *space, u64 address)
+{
+    u64 *table = space->pml4;
+    for (usize level = 4; level > 1; level--)
+    {
+        usize shift = MEMM_LA_PEI_OFFSET + 9 * (level - 1);
+        u64 entry = table[(address >> shift) & 511];
+        if (!memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PRESENT) ||
+            memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PS))
+            return nullptr;
+        table = (u64 *)phys_to_virt(memm_entry_get_address(entry));
+    }
+    return &table[memm_la_get_entry_index(address, MEMM_LA_PEI)];
+}
+
+// 取得以私有4KB页把address映射到physical的pte
+static u64 *find_private_pte(memm_address_space_t *space, u64 address, u64 physical)
+{
+    u64 *pte = find_pte(space, address);
+    if (pte == nullptr ||
+        !memm_entry_flag_get(*pte, MEMM_ENTRY_FLAG_PRESENT) ||
+        memm_entry_flag_get(*pte, MEMM_ENTRY_FLAG_SHARED) ||
+        memm_pte_get_address(*pte) != physical)
+        return nullptr;
+    return pte;
+}
+
+// 遍历页表取得映射address的叶子页表项，并写入它所在页表的级别，没有映射时返回0
+static u64 translation_walk(u64 *pml4, u64 address, usize *level)
+{
+    u64 *table = pml4;
+    for (usize i = 4; i > 0; i--)
+    {
+        usize shift = MEMM_LA_PEI_OFFSET + 9 * (i - 1);
+        u64 entry = table[(address >> shift) & 511];
+        if (!memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PRESENT))
+            return 0;
+        if (i == 1 || memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PS))
+        {
+            *level = i;
+            return entry;
+        }
+        table = (u64 *)phys_to_virt(memm_entry_get_address(entry));
+    }
+    return 0;
+}
+
+bool memm_space_translate(memm_address_space_t *space, u64 address, memm_translation_t *translation)
+{
+    if (!is_cannonical(address))
+        return false;
+    memm_address_space_t *owner = is_user_address(address) ? space : nullptr;
+    translation_cache_entry_t *cache = translation_cache[kernel_cpu_id()];
+    translation_cache_entry_t *hit = nullptr;
+    for (usize level = 1; level <= 3; level++)
+    {
+        translation_cache_entry_t *it = &cache[translation_slot(address, level)];
+        u64 page_size = (u64)1 << (MEMM_LA_PEI_OFFSET + 9 * (level - 1));
+        if (it->generation == translation_generation && it->space == owner &&
+            it->level == level && it->page == (address & ~(page_size - 1)))
+        {
+            hit = it;
+            break;
+        }
+    }
+    if (hit != nullptr)
+        memm_page_counters.translation_hits++;
+    else
+    {
+        usize level;
+        u64 entry = translation_walk(page_space(space, address)->pml4, address, &level);
+        memm_page_counters.translation_misses++;
+        if (entry == 0)
+            return false;
+        u64 page_size = (u64)1 << (MEMM_LA_PEI_OFFSET + 9 * (level - 1));
+        hit = &cache[translation_slot(address, level)];
+        hit->page = address & ~(page_size - 1);
+        hit->entry = entry;
+        hit->space = owner;
+        hit->level = level;
+        hit->generation = translation_generation;
+    }
+    u64 page_size = (u64)1 << (MEMM_LA_PEI_OFFSET + 9 * (hit->level - 1));
+    translation->physical = leaf_address(hit->entry, hit->level) + (address & (page_size - 1));
+    translation->flags =
+        hit->entry &
+        ~(hit->level == 1 ? MEMM_ENTRY_ADDRESS_MASK : MEMM_BP_ENTRY_ADDRESS_MASK) &
+        ~(MEMM_ENTRY_FLAG_ACCECED | MEMM_ENTRY_FLAG_DIRTY);
+    translation->size = page_size / MEMM_PAGE_SIZE;
+    return true;
+}
+
+bool memm_translate(u64 address, memm_translation_t *translation)
+{
+    return memm_space_translate(current_space, address, translation);
+}
+
+// 按地址顺序把level级页表table中[start, end)映射的物理地址追加到list，物理地址连续的部分合并为一项
+// 遇到没有映射的页或list已满时返回false，done为已翻译到的地址
+static bool translate_range(
+    u64 *table, usize level,
+    u64 start, u64 end,
+    memm_sg_entry_t *list, usize capacity, usize *amount,
+    u64 *done)
+{
+    usize shift = MEMM_LA_PEI_OFFSET + 9 * (level - 1);
+    u64 entry_size = (u64)1 << shift;
+    u64 addr = start;
+    while (addr < end)
+    {
+        u64 next = (addr | (entry_size - 1)) + 1;
+        if (next > end || next == 0)
+            next = end;
+        u64 entry = table[(addr >> shift) & 511];
+        if (!memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PRESENT))
+            return false;
+        if (level != 1 && !memm_entry_flag_get(entry, MEMM_ENTRY_FLAG_PS))
+        {
+            u64 *sub = (u64 *)phys_to_virt(memm_entry_get_address(entry));
+            if (!translate_range(sub, level - 1, addr, next, list, capacity, amount, done))
+                return false;
+            addr = next;
+            continue;
+        }
+        u64 physical = leaf_address(entry, level) + (addr & (entry_size - 1));
+        memm_sg_entry_t *last = *amount != 0 ? &list[*amount - 1] : nullptr;
+        if (last != nullptr && last->physical + last->size == physical)
+            last->size += next - addr;
+        else if (*amount == capacity)
+            return false;
+        else
+        {
+            list[*amount].physical = physical;
+            list[*amount].size = next - addr;
+            (*amount)++;
+        }
+        *done = next;
+        addr = next;
+    }
+    return true;
+}
+
+usize memm_translate_range(
+    memm_address_space_t *space,
+    u64 address, usize size,
+    memm_sg_entry_t *list, usize capacity, usize *amount)
+{
+    *amount = 0;
+    if (size == 0 || address + size < address ||
+        !is_cannonical(address) || !is_cannonical(address + size - 1) ||
+        is_user_address(address) != is_user_address(address + size - 1))
+        return 0;
+    u64 done = address;
+    translate_range(
+        page_space(space, address)->pml4, 4,
+        address, address + size,
+        list, capacity, amount, &done);
+    return done - address;
+}
+
+memm_page_state memm_page_age(memm_address_space_t *space, u64 address, u64 physical, bool reclaim)
+{
+    memm_tlb_batch_t batch = {.space = page_space(space, address), .amount = 0, .flush_all = false};
+    u64 *pte = find_private_pte(batch.space, address, physical);
+    if (pte == nullptr)
+        return MEMM_PAGE_STATE_GONE;
+    if (memm_entry_flag_get(*pte, MEMM_ENTRY_FLAG_ACCECED))
+    {
+        *pte &= ~MEMM_ENTRY_FLAG_ACCECED;
+        return MEMM_PAGE_STATE_REFERENCED;
+    }
+    if (memm_entry_flag_get(*pte, MEMM_ENTRY_FLAG_DIRTY))
+        return MEMM_PAGE_STATE_DIRTY;
+    if (!reclaim)
+        return MEMM_PAGE_STATE_IDLE;
+    *pte = 0;
+    memm_tlb_batch_add(&batch, address, MEMM_PAGE_SIZE);
+    memm_tlb_batch_flush(&batch);
+    return MEMM_PAGE_STATE_RECLAIMED;
+}
+
+u64 memm_page_isolate(memm_address_space_t *space, u64 address, u64 physical)
+{
+    memm_tlb_batch_t batch = {.space = page_space(space, address), .amount = 0, .flush_all = false};
+    u64 *pte = find_private_pte(batch.space, address, physical);
+    if (pte == nullptr || memm_entry_flag_get(*pte, MEMM_ENTRY_FLAG_ACCECED))
+        return 0;
+    u64 res = *pte;
+    *pte = 0;
+    memm_tlb_batch_add(&batch, address, MEMM_PAGE_SIZE);
+    memm_tlb_batch_flush(&batch);
+    return res;
+}
+
+void memm_page_install(memm_address_space_t *space, u64 address, u64 pte)
+{
+    // 隔离时只清除了pte，页表仍然存在
+    u64 *entry = find_pte(page_space(space, address), address);
+    if (entry != nullptr)
+        *entry = pte;
+}
+
+// 换入address所在的被换出的页，不是被换出的页时返回false
+static bool swap_fault(u64 address, bool *handled)
+{
+    u64 *pte = find_pte(current_space, address);
+    if (pte == nullptr || !memm_entry_flag_get(*pte, MEMM_ENTRY_FLAG_SWAP))
+        return false;
+    void *entry = memm_swap_entry_get(*pte);
+    u64 physical = memm_zram_fault(entry);
+    *handled = physical != 0;
+    if (physical == 0)
+        return true;
+    // 换入的页的内容不一定是全0的，不能作为没有被写入过的页回收
+    *pte = (*pte & (MEMM_PAGE_TABLE_FLAGS_MASK & ~MEMM_ENTRY_FLAG_SWAP)) |
+           MEMM_ENTRY_FLAG_PRESENT | MEMM_ENTRY_FLAG_DIRTY | physical;
+    memm_zram_put(entry);
+    u64 page = address & ~((u64)MEMM_PAGE_SIZE - 1);
+    memm_lru_add(physical, is_user_address(page) ? current_space : &memm_kernel_address_space, page);
+    return true;
+}
+
+// 处理对address所在页的写入引起的权限错误
+static bool write_fault(u64 address)
+{
+    u64 *table = current_space->pml4;
+    for (usize level = 4; level > 0; level--)
+    {
+        usize shift = MEMM_LA_PEI_OFFSET + 9 * (level - 1);
+        u64 *entry = &table[(address >> shift) & 511];
+        if (!memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_PRESENT))
+            return false;
+        if (level != 1 && !memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_PS))
+        {
+            table = (u64 *)phys_to_virt(memm_entry_get_address(*entry));
+            continue;
+        }
+        memm_tlb_batch_t batch = {.space = current_space, .amount = 0, .flush_all = false};
+        bool res = true;
+        if (memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_WRITE))
+            // TLB中还是修改之前的只读页表项
+            memm_tlb_batch_add(&batch, address, MEMM_PAGE_SIZE);
+        else if (memm_entry_flag_get(*entry, MEMM_ENTRY_FLAG_COW))
+            res = unshare_page(entry, level, address & ~(((u64)1 << shift) - 1), &batch);
+        else
+            res = false;
+        memm_tlb_batch_flush(&batch);
+        return res;
+    }
+    return false;
+}
+
+bool memm_handle_page_fault(u64 address, u64 errcode)
+{
+    if (errcode & MEMM_PF_ERROR_RESERVED)
+        return false;
+    // 用户态访问内核空间总是错误
+    if ((errcode & MEMM_PF_ERROR_USER) && !is_user_address(address))
+        return false;
+    if (errcode & MEMM_PF_ERROR_PRESENT)
+        return (errcode & MEMM_PF_ERROR_WRITE) && write_fault(address);
+    bool handled;
+    if (swap_fault(address, &handled))
+        return handled;
+    return memm_lazy_populate(address, errcode & MEMM_PF_ERROR_WRITE);
+}
+
+// 下一次扫描的起始地址，去掉了canonical型地址的符号扩展
+static u64 collapse_cursor = 0;
+
+#define collapse_canonical(addr) \
+    (((addr) & ((u64)1 << 47)) ? ((addr) | 0xffff000000000000) : (addr))
+
+// 把PDT项pde指向的页表PT合并为一个2MB页，address为它映射的起始地址
+// 所有pte映射相同属性的私有页，并且是对齐且连续的页框或全部是匿名页框时才合并，匿名页框被复制到一个2MB块中
+static void collapse_pt(u64 *pde, u64 *PT, u64 address)
+{
+    u64 ignored = MEMM_ENTRY_ADDRESS_MASK | MEMM_ENTRY_FLAG_ACCECED | MEMM_ENTRY_FLAG_DIRTY;
+    u64 flags = PT[0] & ~ignored;
+    // 共享的页逐页记录共享数量，不能合并
+    if (!memm_entry_flag_get(flags, MEMM_ENTRY_FLAG_PRESENT) ||
+        (flags & (MEMM_ENTRY_FLAG_SHARED | MEMM_ENTRY_FLAG_COW)))
+        return;
+    u64 base = memm_pte_get_address(PT[0]);
+    bool anonymous = frame_is_anonymous(base);
+    bool contiguous = is_aligned(base, ((usize)MEMM_PAGE_SIZE_2M * MEMM_PAGE_SIZE));
+    u64 accessed = 0;
+    for (usize i = 0; i < 512; i++)
+    {
+        u64 physical = memm_pte_get_address(PT[i]);
+        if ((PT[i] & ~ignored) != flags || frame_is_anonymous(physical) != anonymous)
+            return;
+        if (physical != base + i * MEMM_PAGE_SIZE)
+            contiguous = false;
+        if (!anonymous && !contiguous)
+            return;
+        accessed |= PT[i] & (MEMM_ENTRY_FLAG_ACCECED | MEMM_ENTRY_FLAG_DIRTY);
+    }
+
+    u64 large = base;
+    if (anonymous)
+    { // 内存紧张时不为合并分配大块，也不为此触发回收
+        if (memm_get_manager()->reclaim.pressure)
+            return;
+        large = memm_alloc_pages(9, MEMM_FRAME_NORECLAIM);
+        if (large == 0)
+            return;
+        for (usize i = 0; i < 512; i++)
+            memcpy(
+                phys_to_virt(large + i * MEMM_PAGE_SIZE),
+                phys_to_virt(memm_pte_get_address(PT[i])), MEMM_PAGE_SIZE);
+        memm_frame_get(large)->flags |= MEMM_FRAME_FLAG_ANONYMOUS;
+        accessed |= MEMM_ENTRY_FLAG_DIRTY;
+    }
+    // pte中PAT位在PS的位置
+    u64 large_flags = (flags & ~MEMM_PTE_ENTRY_FLAG_PAT) | accessed | MEMM_ENTRY_FLAG_PS;
+    if (flags & MEMM_PTE_ENTRY_FLAG_PAT)
+        large_flags |= MEMM_ENTRY_FLAG_PAT;
+    *pde = large_flags | large;
+
+    memm_tlb_batch_t batch = {.space = current_space, .amount = 0, .flush_all = false};
+    memm_tlb_batch_add(&batch, address, (usize)MEMM_PAGE_SIZE_2M * MEMM_PAGE_SIZE);
+    memm_tlb_batch_flush(&batch);
+    // 原来的页框在刷新TLB后才能释放
+    if (anonymous)
+        for (usize i = 0; i < 512; i++)
+            memm_free_pages(memm_pte_get_address(PT[i]), 0, 0);
+    // 页表最后释放，memm_free_pagetable会把链表指针写入PT[0]
+    memm_free_pagetable(PT);
+    memm_page_counters.promoted_2m_page++;
+}
+
+// 把PDPT项pdpte指向的PDT合并为一个1GB页，所有pde映射相同属性的、对齐且连续的私有的2MB页时才合并
+static void collapse_pdt(u64 *pdpte, u64 *PDT, u64 address)
+{
+    if (!memm_1g_page_supported)
+        return;
+    u64 ignored = MEMM_BP_ENTRY_ADDRESS_MASK | MEMM_ENTRY_FLAG_ACCECED | MEMM_ENTRY_FLAG_DIRTY;
+    u64 flags = PDT[0] & ~ignored;
+    if (!memm_entry_flag_get(flags, MEMM_ENTRY_FLAG_PRESENT) ||
+        !memm_entry_flag_get(flags, MEMM_ENTRY_FLAG_PS) ||
+        (flags & (MEMM_ENTRY_FLAG_SHARED | MEMM_ENTRY_FLAG_COW)))
+        return;
+    u64 base = PDT[0] & MEMM_BP_ENTRY_ADDRESS_MASK;
+    if (!is_aligned(base, ((usize)MEMM_PAGE_SIZE_1G * MEMM_PAGE_SIZE)))
+        return;
+    u64 accessed = 0;
+    for (usize i = 0; i < 512; i++)
+    {
+        u64 physical = PDT[i] & MEMM_BP_ENTRY_ADDRESS_MASK;
+        // 匿名的2MB页按块释放，不能合并
+        if ((PDT[i] & ~ignored) != flags ||
+            physical != base + i * (usize)MEMM_PAGE_SIZE_2M * MEMM_PAGE_SIZE ||
+            frame_is_anonymous(physical))
+            return;
+        accessed |= PDT[i] & (MEMM_ENTRY_FLAG_ACCECED | MEMM_ENTRY_FLAG_DIRTY);
+    }
+    *pdpte = flags | accessed | base;
+    memm_free_pagetable(PDT);
+
+    memm_tlb_batch_t batch = {.space = current_space, .amount = 0, .flush_all = false};
+    memm_tlb_batch_add(&batch, address, (usize)MEMM_PAGE_SIZE_1G * MEMM_PAGE_SIZE);
+    memm_tlb_batch_flush(&batch);
+    memm_page_counters.promoted_1g_page++;
+}
+
+// 从collapse_cursor开始扫描level级页表table中的项，base为table映射的起始地址
+// 每读取一个页表项消耗一份budget，用完时返回false，collapse_cursor停在下一个要扫描的项
+static bool collapse_walk(u64 *table, usize level, u64 base, usize *budget)
+{
+    usize shift = MEMM_LA_PEI_OFFSET + 9 * (level - 1);
+    u64 entry_size = (u64)1 << shift;
+    for (usize i = (collapse_cursor >> shift) & 511; i < 512; i++)
+    {
+        u64 addr = base + ((u64)i << shift);
+        if (*budget == 0)
+            return false;
+        (*budget)--;
+        if (!memm_entry_flag_get(table[i], MEMM_ENTRY_FLAG_PRESENT) ||
+            memm_entry_flag_get(table[i], MEMM_ENTRY_FLAG_PS))
+        {
+            collapse_cursor = addr + entry_size;
+            continue;
+        }
+        u64 *sub = (u64 *)phys_to_virt(memm_entry_get_address(table[i]));
+        if (level == 2)
+        {
+            *budget -= min(*budget, 512);
+            collapse_pt(&table[i], sub, collapse_canonical(addr));
+        }
+        else
+        {
+            if (!collapse_walk(sub, level - 1, addr, budget))
+                return false;
+            if (level == 3)
+                collapse_pdt(&table[i], sub, collapse_canonical(addr));
+        }
+        collapse_cursor = addr + entry_size;
+    }
+    return true;
+}
+
+void memm_collapse_idle()
+{
+    if (memm_get_manager()->frame_allocator == nullptr)
+        return;
+    usize budget = MEMM_COLLAPSE_BATCH;
+    memm_page_counters.collapse_scanned += MEMM_COLLAPSE_BATCH;
+    if (collapse_walk(current_space->pml4, 4, 0, &budget))
+        collapse_cursor = 0;
+    memm_page_counters.collapse_scanned -= budget;
+}
@@ -9,3 +9,73 @@ reload_pml4:
     pop rax
 
     ret
+
+    global invalidate_page
+invalidate_page:
+    invlpg [rdi]
+    ret
+
+    global flush_tlb
+flush_tlb:
+    push rax
+    push rdx
+
+    ; 开启了全局页时，切换CR4.PGE以同时刷新全局页
+    mov rax, cr4
+    test rax, 0x80
+    jz .reload
+    mov rdx, rax
+    and rdx, ~0x80
+    mov cr4, rdx
+    mov cr4, rax
+    jmp .done
+.reload:
+    mov rax, cr3
+    mov cr3, rax
+.done:
+
+    pop rdx
+    pop rax
+
+    ret
+
+    global write_cr3
+write_cr3:
+    mov cr3, rdi
+    ret
+
+    global invpcid
+invpcid:
+    sub rsp, 16
+    mov [rsp], rsi
+    mov [rsp + 8], rdx
+    invpcid rdi, [rsp]
+    add rsp, 16
+    ret
+
+    global clear_page_nontemporal
+clear_page_nontemporal:
+    push rax
+    push rcx
+
+    xor eax, eax
+    mov ecx, 4096 / 64
+.loop:
+    movnti [rdi], rax
+    movnti [rdi + 8], rax
+    movnti [rdi + 16], rax
+    movnti [rdi + 24], rax
+    movnti [rdi + 32], rax
+    movnti [rdi + 40], rax
+    movnti [rdi + 48], rax
+    movnti [rdi + 56], rax
+    add rdi, 64
+    dec ecx
+    jnz .loop
+    ; 非临时存储是弱有序的，返回前保证它们对其它访问可见
+    sfence
+
+    pop rcx
+    pop rax
+
+    ret
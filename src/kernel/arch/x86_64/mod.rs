@@ -1,2 +1,3 @@
+pub mod fpu;
 pub mod interrupt;
 pub mod proc;
@@ -1,8 +1,20 @@
 #include <kernel/syscall.h>
+#include <kernel/memm.h>
 
 #include <libk/string.h>
 
 void syscall_init()
 {
     memset(&system_calls_table, 0, sizeof(system_calls_table));
+    // 系统调用入口切换到这个栈，没有栈时不登记任何处理函数，所有系统调用都返回-1
+    u8 *stack = memm_kernel_allocate_aligned(SYSCALL_KERNEL_STACK_SIZE, 16, MEMM_TAG_OTHER);
+    if (stack == nullptr)
+        return;
+    set_kernel_stack_cache((usize)stack + SYSCALL_KERNEL_STACK_SIZE);
+
+    system_calls_table[SYSCALL_MMAP] = memm_syscall_mmap;
+    system_calls_table[SYSCALL_MUNMAP] = memm_syscall_munmap;
+    system_calls_table[SYSCALL_MPROTECT] = memm_syscall_mprotect;
+    system_calls_table[SYSCALL_ALLOCATE] = memm_syscall_allocate;
+    system_calls_table[SYSCALL_FREE] = memm_syscall_free;
 }
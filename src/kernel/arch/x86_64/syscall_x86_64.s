@@ -8,34 +8,62 @@ kernel_stack_cache:
 
     section .text
     global systemcall_procedure
-    global save_kernel_stack
+    global set_kernel_stack_cache
+    global return_from_systemcall
 systemcall_procedure:
     endbr64
-    call load_kernel_stack
-    push rbp
-    mov rbp, rsp
+    ; 与缓存交换rbp、rsp，切换到内核栈，用户栈保存在缓存中
+    xchg rbp, [kernel_stack_cache]
+    xchg rsp, [kernel_stack_cache + 8]
+    ; sysret使用的rip与rflags缓存
+    push rcx
+    push r11
+    ; 调用者保存的参数寄存器，返回时恢复
+    push rsi
+    push rdx
+    push r8
+    push r9
+    push r10
 
-    shl rax, 3      ; rax *= 8
-    ; 将对应调用号的系统调用加载至rax
-    lea rdi, [system_calls_table]
-    lea rax, [rax + rdi]
     ; 判断是否为空调用
-    cmp rax, 0
-    je systemcall_procedure_none_call
-    mov rax, [rax]
+    cmp rax, 256
+    jae systemcall_procedure_none_call
+    lea rbx, [system_calls_table]
+    mov rax, [rbx + rax * 8]
+    test rax, rax
+    jz systemcall_procedure_none_call
+
+    ; 按System V调用约定传递参数，参数7、8通过堆栈传递，调用时rsp按16字节对齐
+    sub rsp, 8
+    push r15
+    push r14
+    mov rdi, rdx
+    mov rsi, r8
+    mov rdx, r9
+    mov rcx, r10
+    mov r8, r12
+    mov r9, r13
     ; 调用对应的系统调用
     call rax
-
-    leave
-    call save_kernel_stack
-    sysret
+    add rsp, 24
+    jmp systemcall_procedure_return
 
 systemcall_procedure_none_call:
     ; TODO 调用了不存在的系统调用，属于无法恢复的错误，应保存错误状态并结束调用进程
-    ; 暂时直接sysret
-    leave
-    call save_kernel_stack
-    sysret
+    ; 暂时返回-1
+    mov rax, -1
+
+systemcall_procedure_return:
+    pop r10
+    pop r9
+    pop r8
+    pop rdx
+    pop rsi
+    pop r11
+    pop rcx
+    xchg rsp, [kernel_stack_cache + 8]
+    xchg rbp, [kernel_stack_cache]
+    o64 sysret
 
 ; void set_kernel_stack_cache(usize stack)
 set_kernel_stack_cache:
@@ -52,40 +80,4 @@ set_kernel_stack_cache:
 
 ; void return_from_systemcall()
 return_from_systemcall:
-    sysret
-
-save_kernel_stack:
-    endbr64
-    lea rbx, [kernel_stack_cache]
-    ; 交换[rbx]与rbp
-    mov rdi, [rbx]
-    xor rbp, rdi
-    xor rdi, rbp
-    xor rbp, rdi
-    mov [rbx], rdi
-    lea rbx, [rbx + 8]
-    ; 交换[rbx]与rsp
-    mov rdi, [rbx]
-    xor rsp, rdi
-    xor rdi, rsp
-    xor rsp, rdi
-    mov [rbx], rdi
-    ret
-
-load_kernel_stack:
-    endbr64
-    lea rbx, [kernel_stack_cache]
-    ; 交换[rbx]与rbp
-    mov rdi, [rbx]
-    xor rbp, rdi
-    xor rdi, rbp
-    xor rbp, rdi
-    mov [rbx], rdi
-    lea rbx, [rbx + 8]
-    ; 交换[rbx]与rsp
-    mov rdi, [rbx]
-    xor rsp, rdi
-    xor rdi, rsp
-    xor rsp, rdi
-    mov [rbx], rdi
-    ret
+    o64 sysret
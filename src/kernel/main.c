@@ -1,17 +1,23 @@
 #include <kernel/kernel.h>
+#include <kernel/acpi.h>
 #include <kernel/tty.h>
 #include <kernel/memm.h>
 #include <kernel/interrupt.h>
 #include <kernel/syscall.h>
+#include <kernel/fpu.h>
 
 #include <libk/multiboot2.h>
 #include <libk/math.h>
+#include <libk/string.h>
 
 // 通过bootinfo获取临时的帧缓冲区信息
 void get_frame_buffer_with_bootinfo(framebuffer *fb, bootinfo_t *bootinfo);
 
 void kmain(void *mb2_bootinfo)
 {
+    // 按处理器特性选择memcpy与memset的实现
+    string_init();
+
     // 创建bootinfo对象
     bootinfo_t bootinfo;
     bootinfo_new(&bootinfo, mb2_bootinfo);
@@ -36,6 +42,16 @@ void kmain(void *mb2_bootinfo)
 
     // 初始化内存管理模块
     memory_manager_t *memm = memm_new(mem_size);
+    memm_address_space_init();
+    acpi_init(&bootinfo);
+    memm_frame_init(&bootinfo);
+
+    // 开启FPU与向量寄存器，之后内核代码可以在kernel_fpu_begin与kernel_fpu_end之间使用
+    kernel_fpu_init();
+
+    // 初始化中断管理
+    // 帧缓冲区按需映射，需要在使用tty之前注册缺页异常处理程序
+    interrupt_init();
 
     // 初始化tty模块
     tty_controller_t *tty_controler = tty_controller_new();
@@ -45,9 +61,6 @@ void kmain(void *mb2_bootinfo)
     tty_set_framebuffer(tty0, &fb);
     tty_enable(tty0);
 
-    // 初始化中断管理
-    interrupt_init();
-
     int i = 1 / 0;
 
     // 初始化系统调用
@@ -73,8 +86,9 @@ void get_frame_buffer_with_bootinfo(framebuffer *fb, bootinfo_t *bootinfo)
     fb->height = fbinfo->framebuffer_height;
     fb->pixsize = fbinfo->framebuffer_bpp / 8;
     fb->pixtype = rgb; // 绝大多数显示器配置都是rgb，不需要特意判断
-    memm_map_pageframes_to(
-        (u64)fb->pointer, (u64)fb->pointer,
-        fb->width * fb->height * fb->pixsize,
-        false, true);
+    // 帧缓冲区只被写入，使用写合并，在第一次访问时才映射
+    memm_lazy_region_register(
+        (u64)fb->pointer, fb->width * fb->height * fb->pixsize,
+        false, (u64)fb->pointer,
+        true, MEMM_MEMORY_TYPE_WC);
 }
@@ -1,7 +1,9 @@
-use crate::kernel::tty::tty::Tty;
+use crate::kernel::{memm::memm::memm_idle, tty::tty::Tty};
 
 #[no_mangle]
 extern "C" fn kmain_rust() -> ! {
     let tty = Tty::from_id(0).unwrap();
-    loop {}
+    loop {
+        unsafe { memm_idle() };
+    }
 }
@@ -4,89 +4,100 @@
 
 #include <libk/bits.h>
 
+// 空cell的content的最后8字节
+#define raw_allocator_cell_footer(cell) (((usize *)raw_allocator_next_cell(cell))[-1])
+// 只在设置了RAW_ALLOCATOR_CELL_PREV_FREE时有效
+#define raw_allocator_prev_cell(cell) \
+    ((raw_allocator_cell *)((void *)(cell) - ((usize *)(cell))[-1] - sizeof(raw_allocator_cell)))
+
+// 写入空cell的边界标记，并告知后一个cell
+static inline void raw_allocator_cell_mark_free(raw_allocator_t *allocator, raw_allocator_cell *cell)
+{
+    raw_allocator_cell_footer(cell) = raw_allocator_cell_capacity(cell);
+    raw_allocator_cell *ncell = raw_allocator_next_cell(cell);
+    if ((void *)ncell < raw_allocator_end(allocator))
+        ncell->capacity |= RAW_ALLOCATOR_CELL_PREV_FREE;
+}
+
 void raw_allocator_new(raw_allocator_t *allocator, usize size)
 {
-    allocator->size = size - sizeof(allocator->size);
-    allocator->free_count = 0;
-    allocator->rest_memory = size - sizeof(raw_allocator_t);
-    allocator->cells[0].capacity = size - sizeof(raw_allocator_t) - sizeof(raw_allocator_cell);
-    allocator->cells[0].length = 0;
+    allocator->size = size & ~(usize)15;
+    allocator->rest_memory = allocator->size - sizeof(raw_allocator_t) - sizeof(raw_allocator_cell);
+    allocator->cells[0].owner = nullptr;
+    allocator->cells[0].capacity = allocator->rest_memory | RAW_ALLOCATOR_CELL_FREE;
+    raw_allocator_cell_mark_free(allocator, allocator->cells);
 }
 
 void *raw_allocator_allocate(raw_allocator_t *allocator, usize size)
 {
+    if (size == 0)
+    { // 只检查是否还有可用空间
+        if (allocator->rest_memory == 0)
+            return nullptr;
+        return allocator;
+    }
     usize real_size = size;
     align_to(real_size, 16);
-    raw_allocator_cell *cell = &allocator->cells;
+    raw_allocator_cell *cell = allocator->cells;
     while ((void *)cell < raw_allocator_end(allocator))
     {
-        while ( // 确保cell指向的内容还在这个allocator内
-            (void *)cell < raw_allocator_end(allocator) &&
-            cell->length != 0)
-        {
-            cell = raw_allocator_next_cell(cell);
-        }
-        if (real_size <= cell->capacity)
+        if ((cell->capacity & RAW_ALLOCATOR_CELL_FREE) &&
+            real_size <= raw_allocator_cell_capacity(cell))
             break;
-        else
-            cell = raw_allocator_next_cell(cell);
+        cell = raw_allocator_next_cell(cell);
     }
-    if ((void *)cell < raw_allocator_end(allocator))
-        goto fitable_cell_finded;
-    else
+    if ((void *)cell >= raw_allocator_end(allocator))
         return nullptr;
 
-fitable_cell_finded:
-    cell->length = size;
-    if (real_size < cell->capacity)
+    usize cap = raw_allocator_cell_capacity(cell);
+    if (cap >= real_size + sizeof(raw_allocator_cell) + 16)
+    { // 分裂出剩余的部分
+        cell->capacity = real_size | (cell->capacity & RAW_ALLOCATOR_CELL_PREV_FREE);
+        raw_allocator_cell *ncell = raw_allocator_next_cell(cell);
+        ncell->owner = nullptr;
+        ncell->capacity = (cap - real_size - sizeof(raw_allocator_cell)) | RAW_ALLOCATOR_CELL_FREE;
+        raw_allocator_cell_mark_free(allocator, ncell);
+        allocator->rest_memory -= real_size + sizeof(raw_allocator_cell);
+    }
+    else
     {
-        usize cap = cell->capacity;
-        cell->capacity = real_size;
+        cell->capacity &= ~RAW_ALLOCATOR_CELL_FREE;
         raw_allocator_cell *ncell = raw_allocator_next_cell(cell);
-        ncell->capacity = cap - real_size - sizeof(raw_allocator_cell);
-        ncell->length = 0;
+        if ((void *)ncell < raw_allocator_end(allocator))
+            ncell->capacity &= ~RAW_ALLOCATOR_CELL_PREV_FREE;
+        allocator->rest_memory -= cap;
     }
-    allocator->rest_memory -= real_size;
     return cell->content;
 }
 
-static inline void raw_allocator_cellmerge(raw_allocator_t *allocator)
+void raw_allocator_free(raw_allocator_t *allocator, void *mem)
 {
-    raw_allocator_cell *cell = allocator->cells;
+    raw_allocator_cell *cell = mem - sizeof(raw_allocator_cell);
+    if (cell->capacity & RAW_ALLOCATOR_CELL_FREE)
+        return;
+    allocator->rest_memory += raw_allocator_cell_capacity(cell);
+    if (cell->capacity & RAW_ALLOCATOR_CELL_PREV_FREE)
+    {
+        raw_allocator_cell *pcell = raw_allocator_prev_cell(cell);
+        pcell->capacity += sizeof(raw_allocator_cell) + raw_allocator_cell_capacity(cell);
+        cell = pcell;
+        allocator->rest_memory += sizeof(raw_allocator_cell);
+    }
+    else
+        cell->capacity |= RAW_ALLOCATOR_CELL_FREE;
+
     raw_allocator_cell *ncell = raw_allocator_next_cell(cell);
-    while ((void *)ncell < raw_allocator_end(allocator))
+    if ((void *)ncell < raw_allocator_end(allocator) &&
+        (ncell->capacity & RAW_ALLOCATOR_CELL_FREE))
     {
-        while ( // 首先保证ncell还在这个allocator内
-            (void *)ncell < raw_allocator_end(allocator) &&
-            cell->length == 0 && ncell->length == 0)
-        {
-            cell->capacity += ncell->capacity + sizeof(raw_allocator_cell);
-            ncell = raw_allocator_next_cell(ncell);
-        }
-        cell = ncell;
-        ncell = raw_allocator_next_cell(cell);
+        cell->capacity += sizeof(raw_allocator_cell) + raw_allocator_cell_capacity(ncell);
+        allocator->rest_memory += sizeof(raw_allocator_cell);
     }
+    raw_allocator_cell_mark_free(allocator, cell);
 }
 
-void raw_allocator_free(raw_allocator_t *allocator, void *mem)
+usize raw_allocator_usable_size(raw_allocator_t *allocator, void *mem)
 {
-    raw_allocator_cell *cell = allocator->cells;
-    while ((void *)cell < raw_allocator_end(allocator))
-    { // TODO  内存错误
-        if (mem == cell->content)
-        {
-            cell->length = 0;
-            break;
-        }
-        cell = raw_allocator_next_cell(cell);
-    }
-    allocator->rest_memory += cell->capacity + sizeof(raw_allocator_cell);
-    allocator->free_count++;
-    if ( // 可用内存不超过当前allocator的 5% 或调用free次数很多时
-        allocator->size / allocator->rest_memory > 20 ||
-        allocator->free_count > RAW_ALLOCATOR_FREE_MAX)
-    {
-        raw_allocator_cellmerge(allocator);
-        allocator->free_count = 0;
-    }
+    raw_allocator_cell *cell = mem - sizeof(raw_allocator_cell);
+    return raw_allocator_cell_capacity(cell);
 }
@@ -0,0 +1,211 @@
+#include <kernel/memm/allocator/slab.h>
+
+#include <kernel/kernel.h>
+
+#include <libk/bits.h>
+
+#define slab_of(object) ((slab_t *)((usize)(object) & ~((usize)SLAB_SIZE - 1)))
+#define slab_object_next(object) (((void **)(object))[-1])
+
+// 通用分配接口中分配size字节使用的缓存
+static inline usize slab_kmalloc_index(usize size)
+{
+    if (size <= SLAB_KMALLOC_MIN)
+        return 0;
+    return bit_scan_reverse(size - 1) - 3;
+}
+
+static inline void slab_list_push(slab_t **list, slab_t *slab)
+{
+    slab->prev = nullptr;
+    slab->next = *list;
+    if (*list != nullptr)
+        (*list)->prev = slab;
+    *list = slab;
+}
+
+static inline void slab_list_remove(slab_t **list, slab_t *slab)
+{
+    if (slab->prev != nullptr)
+        slab->prev->next = slab->next;
+    else
+        *list = slab->next;
+    if (slab->next != nullptr)
+        slab->next->prev = slab->prev;
+    slab->prev = slab->next = nullptr;
+}
+
+static void *slab_page_get(slab_allocator_t *allocator)
+{
+    void *page = allocator->free_slabs;
+    if (page != nullptr)
+    {
+        allocator->free_slabs = *(void **)page;
+        return page;
+    }
+    if (allocator->brk + SLAB_SIZE > allocator->end)
+        return nullptr;
+    page = allocator->brk;
+    allocator->brk += SLAB_SIZE;
+    return page;
+}
+
+static void slab_page_put(slab_allocator_t *allocator, void *page)
+{
+    *(void **)page = allocator->free_slabs;
+    allocator->free_slabs = page;
+}
+
+static slab_t *slab_new(slab_cache_t *cache)
+{
+    slab_t *slab = slab_page_get(cache->allocator);
+    if (slab == nullptr)
+        return nullptr;
+    slab->cache = cache;
+    slab->prev = slab->next = nullptr;
+    slab->inuse = 0;
+    slab->free = nullptr;
+    // 倒序构造空闲链表，使低地址的对象先被分配
+    void *slot = (void *)slab + SLAB_HEADER_SIZE + cache->objects_per_slab * cache->slot_size;
+    for (usize i = 0; i < cache->objects_per_slab; i++)
+    {
+        slot -= cache->slot_size;
+        void *object = slot + SLAB_OBJECT_HEADER_SIZE;
+        ((void **)object)[-2] = nullptr;
+        slab_object_next(object) = slab->free;
+        slab->free = object;
+        if (cache->ctor != nullptr)
+            cache->ctor(object);
+    }
+    return slab;
+}
+
+static void slab_cache_init(slab_cache_t *cache, slab_allocator_t *allocator, usize size, slab_ctor_t ctor)
+{
+    cache->object_size = size;
+    usize slot_size = size;
+    align_to(slot_size, 16);
+    cache->slot_size = slot_size + SLAB_OBJECT_HEADER_SIZE;
+    cache->objects_per_slab = (SLAB_SIZE - SLAB_HEADER_SIZE) / cache->slot_size;
+    cache->ctor = ctor;
+    cache->partial = cache->full = cache->empty = nullptr;
+    cache->empty_amount = 0;
+    cache->allocator = allocator;
+}
+
+void slab_allocator_new(slab_allocator_t *allocator, usize size)
+{
+    allocator->size = size;
+    allocator->free_slabs = nullptr;
+    usize brk = (usize)allocator + sizeof(slab_allocator_t);
+    align_to(brk, SLAB_SIZE);
+    allocator->brk = (void *)brk;
+    allocator->end = (void *)(((usize)allocator + size) & ~((usize)SLAB_SIZE - 1));
+    for (usize i = 0; i < SLAB_KMALLOC_CACHES; i++)
+        slab_cache_init(&allocator->caches[i], allocator, SLAB_KMALLOC_MIN << i, nullptr);
+    slab_cache_init(&allocator->cache_cache, allocator, sizeof(slab_cache_t), nullptr);
+}
+
+void *slab_cache_alloc(slab_cache_t *cache)
+{
+    slab_t *slab = cache->partial;
+    if (slab == nullptr)
+    {
+        slab = cache->empty;
+        if (slab != nullptr)
+        {
+            slab_list_remove(&cache->empty, slab);
+            cache->empty_amount--;
+        }
+        else if ((slab = slab_new(cache)) == nullptr)
+            return nullptr;
+        slab_list_push(&cache->partial, slab);
+    }
+    void *object = slab->free;
+    slab->free = slab_object_next(object);
+    slab->inuse++;
+    if (slab->inuse == cache->objects_per_slab)
+    {
+        slab_list_remove(&cache->partial, slab);
+        slab_list_push(&cache->full, slab);
+    }
+    return object;
+}
+
+void slab_cache_free(slab_cache_t *cache, void *object)
+{
+    slab_t *slab = slab_of(object);
+    slab_object_next(object) = slab->free;
+    slab->free = object;
+    if (slab->inuse == cache->objects_per_slab)
+        slab_list_remove(&cache->full, slab);
+    else
+        slab_list_remove(&cache->partial, slab);
+    slab->inuse--;
+    if (slab->inuse != 0)
+        slab_list_push(&cache->partial, slab);
+    else if (cache->empty_amount < SLAB_EMPTY_MAX)
+    {
+        slab_list_push(&cache->empty, slab);
+        cache->empty_amount++;
+    }
+    else
+        slab_page_put(cache->allocator, slab);
+}
+
+slab_cache_t *slab_cache_create(slab_allocator_t *allocator, usize size, slab_ctor_t ctor)
+{
+    if (size == 0 || size + SLAB_OBJECT_HEADER_SIZE > SLAB_SIZE - SLAB_HEADER_SIZE)
+        return nullptr;
+    slab_cache_t *cache = slab_cache_alloc(&allocator->cache_cache);
+    if (cache == nullptr)
+        return nullptr;
+    slab_cache_init(cache, allocator, size, ctor);
+    return cache;
+}
+
+bool slab_cache_destroy(slab_cache_t *cache)
+{
+    if (cache->partial != nullptr || cache->full != nullptr)
+        return false;
+    while (cache->empty != nullptr)
+    {
+        slab_t *slab = cache->empty;
+        slab_list_remove(&cache->empty, slab);
+        slab_page_put(cache->allocator, slab);
+    }
+    cache->empty_amount = 0;
+    slab_cache_free(&cache->allocator->cache_cache, cache);
+    return true;
+}
+
+void *slab_allocator_allocate(slab_allocator_t *allocator, usize size)
+{
+    if (size > SLAB_KMALLOC_MAX)
+        return nullptr;
+    if (size == 0)
+    { // 只检查是否还有可用空间
+        if (allocator->free_slabs == nullptr && allocator->brk + SLAB_SIZE > allocator->end)
+            return nullptr;
+        return allocator;
+    }
+    return slab_cache_alloc(&allocator->caches[slab_kmalloc_index(size)]);
+}
+
+void slab_allocator_free(slab_allocator_t *allocator, void *mem)
+{
+    slab_t *slab = slab_of(mem);
+    slab_cache_free(slab->cache, mem);
+}
+
+usize slab_allocator_free_sized(slab_allocator_t *allocator, void *mem, usize size)
+{
+    slab_cache_t *cache = &allocator->caches[slab_kmalloc_index(size)];
+    slab_cache_free(cache, mem);
+    return cache->object_size;
+}
+
+usize slab_allocator_usable_size(slab_allocator_t *allocator, void *mem)
+{
+    return slab_of(mem)->cache->object_size;
+}
@@ -0,0 +1,177 @@
+#include <kernel/memm/allocator/tlsf.h>
+
+#include <kernel/kernel.h>
+
+#include <libk/bits.h>
+#include <libk/math.h>
+#include <libk/string.h>
+
+#define tlsf_block_size(block) \
+    ((block)->size & ~(TLSF_BLOCK_FREE | TLSF_BLOCK_PREV_FREE))
+#define tlsf_block_content(block) \
+    ((void *)(block) + TLSF_BLOCK_HEADER_SIZE)
+#define tlsf_block_from_content(mem) \
+    ((tlsf_block_t *)((void *)(mem) - TLSF_BLOCK_HEADER_SIZE))
+#define tlsf_block_next(block) \
+    ((tlsf_block_t *)(tlsf_block_content(block) + tlsf_block_size(block)))
+// 空闲块内容的最后8字节，存放块头部的地址
+#define tlsf_block_footer(block) \
+    (((tlsf_block_t **)tlsf_block_next(block))[-1])
+// 只在设置了TLSF_BLOCK_PREV_FREE时有效
+#define tlsf_block_prev(block) \
+    (((tlsf_block_t **)(block))[-1])
+
+static inline void tlsf_mapping(usize size, usize *fl, usize *sl)
+{
+    if (size < TLSF_SMALL_BLOCK_SIZE)
+    {
+        *fl = 0;
+        *sl = size / (TLSF_SMALL_BLOCK_SIZE / TLSF_SL_INDEX_COUNT);
+    }
+    else
+    {
+        usize f = bit_scan_reverse(size);
+        *sl = (size >> (f - TLSF_SL_INDEX_COUNT_LOG2)) ^ (1 << TLSF_SL_INDEX_COUNT_LOG2);
+        *fl = f - (TLSF_FL_INDEX_SHIFT - 1);
+    }
+}
+
+static inline void tlsf_insert(tlsf_allocator_t *allocator, tlsf_block_t *block)
+{
+    usize fl, sl;
+    tlsf_mapping(tlsf_block_size(block), &fl, &sl);
+    tlsf_block_t *head = allocator->blocks[fl][sl];
+    block->next_free = head;
+    block->prev_free = nullptr;
+    if (head != nullptr)
+        head->prev_free = block;
+    allocator->blocks[fl][sl] = block;
+    allocator->fl_bitmap |= (u32)1 << fl;
+    allocator->sl_bitmap[fl] |= (u32)1 << sl;
+}
+
+static inline void tlsf_remove(tlsf_allocator_t *allocator, tlsf_block_t *block)
+{
+    usize fl, sl;
+    tlsf_mapping(tlsf_block_size(block), &fl, &sl);
+    if (block->prev_free != nullptr)
+        block->prev_free->next_free = block->next_free;
+    else
+        allocator->blocks[fl][sl] = block->next_free;
+    if (block->next_free != nullptr)
+        block->next_free->prev_free = block->prev_free;
+    if (allocator->blocks[fl][sl] == nullptr)
+    {
+        allocator->sl_bitmap[fl] &= ~((u32)1 << sl);
+        if (allocator->sl_bitmap[fl] == 0)
+            allocator->fl_bitmap &= ~((u32)1 << fl);
+    }
+}
+
+void tlsf_allocator_new(tlsf_allocator_t *allocator, usize size)
+{
+    memset(allocator, 0, sizeof(tlsf_allocator_t));
+    allocator->size = size;
+    usize start = (usize)allocator + sizeof(tlsf_allocator_t);
+    align_to(start, TLSF_ALIGN_SIZE);
+    usize end = ((usize)allocator + size) & ~((usize)TLSF_ALIGN_SIZE - 1);
+
+    // 末尾保留一个大小为0的已分配块作为哨兵，使最后一个块也有后继
+    tlsf_block_t *block = (tlsf_block_t *)start;
+    usize block_size = end - start - 2 * TLSF_BLOCK_HEADER_SIZE;
+    block_size = min(block_size, ((usize)1 << TLSF_FL_INDEX_MAX) - TLSF_ALIGN_SIZE);
+    block->size = block_size | TLSF_BLOCK_FREE;
+    tlsf_block_t *sentinel = tlsf_block_next(block);
+    sentinel->owner = nullptr;
+    sentinel->size = TLSF_BLOCK_PREV_FREE;
+    tlsf_block_footer(block) = block;
+    tlsf_insert(allocator, block);
+    allocator->rest_memory = block_size;
+}
+
+void *tlsf_allocator_allocate(tlsf_allocator_t *allocator, usize size)
+{
+    if (size == 0)
+    { // 只检查是否还有可用空间
+        if (allocator->fl_bitmap == 0)
+            return nullptr;
+        return allocator;
+    }
+    if (size >= (usize)1 << (TLSF_FL_INDEX_MAX - 1))
+        return nullptr;
+    usize real_size = size;
+    align_to(real_size, TLSF_ALIGN_SIZE);
+    real_size = max(real_size, TLSF_BLOCK_SIZE_MIN);
+
+    // 向上取整到下一个二级的起点，使找到的链表中的任何块都足够大
+    usize search_size = real_size;
+    if (search_size >= TLSF_SMALL_BLOCK_SIZE)
+        search_size += ((usize)1 << (bit_scan_reverse(search_size) - TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+    usize fl, sl;
+    tlsf_mapping(search_size, &fl, &sl);
+    u32 sl_map = allocator->sl_bitmap[fl] & (~(u32)0 << sl);
+    if (sl_map == 0)
+    {
+        u32 fl_map = allocator->fl_bitmap & (~(u32)0 << (fl + 1));
+        if (fl_map == 0)
+            return nullptr;
+        fl = bit_scan_forward(fl_map);
+        sl_map = allocator->sl_bitmap[fl];
+    }
+    sl = bit_scan_forward(sl_map);
+    tlsf_block_t *block = allocator->blocks[fl][sl];
+    tlsf_remove(allocator, block);
+
+    usize block_size = tlsf_block_size(block);
+    if (block_size >= real_size + TLSF_BLOCK_HEADER_SIZE + TLSF_BLOCK_SIZE_MIN)
+    { // 分裂出剩余的部分
+        tlsf_block_t *rest = tlsf_block_content(block) + real_size;
+        rest->size = (block_size - real_size - TLSF_BLOCK_HEADER_SIZE) | TLSF_BLOCK_FREE;
+        block->size = real_size | (block->size & TLSF_BLOCK_PREV_FREE);
+        tlsf_block_footer(rest) = rest;
+        tlsf_insert(allocator, rest);
+        allocator->rest_memory -= real_size + TLSF_BLOCK_HEADER_SIZE;
+    }
+    else
+    {
+        block->size &= ~TLSF_BLOCK_FREE;
+        tlsf_block_next(block)->size &= ~TLSF_BLOCK_PREV_FREE;
+        allocator->rest_memory -= block_size;
+    }
+    return tlsf_block_content(block);
+}
+
+void tlsf_allocator_free(tlsf_allocator_t *allocator, void *mem)
+{
+    tlsf_block_t *block = tlsf_block_from_content(mem);
+    if (block->size & TLSF_BLOCK_FREE)
+        return;
+    allocator->rest_memory += tlsf_block_size(block);
+    if (block->size & TLSF_BLOCK_PREV_FREE)
+    {
+        tlsf_block_t *prev = tlsf_block_prev(block);
+        tlsf_remove(allocator, prev);
+        prev->size += TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(block);
+        block = prev;
+        allocator->rest_memory += TLSF_BLOCK_HEADER_SIZE;
+    }
+    else
+        block->size |= TLSF_BLOCK_FREE;
+
+    tlsf_block_t *next = tlsf_block_next(block);
+    if (next->size & TLSF_BLOCK_FREE)
+    {
+        tlsf_remove(allocator, next);
+        block->size += TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(next);
+        allocator->rest_memory += TLSF_BLOCK_HEADER_SIZE;
+        next = tlsf_block_next(block);
+    }
+    tlsf_block_footer(block) = block;
+    next->size |= TLSF_BLOCK_PREV_FREE;
+    tlsf_insert(allocator, block);
+}
+
+usize tlsf_allocator_usable_size(tlsf_allocator_t *allocator, void *mem)
+{
+    return tlsf_block_size(tlsf_block_from_content(mem));
+}
@@ -0,0 +1,177 @@
+#include <kernel/memm/buddy.h>
+
+#include <libk/string.h>
+#include <libk/math.h>
+
+void buddy_allocator_new(buddy_allocator_t *allocator, memm_frame_t *frames, usize frame_amount)
+{
+    memset(allocator, 0, sizeof(buddy_allocator_t));
+    allocator->frames = frames;
+    allocator->frame_amount = frame_amount;
+    memset(frames, 0, frame_amount * sizeof(memm_frame_t));
+    for (usize i = 0; i < frame_amount; i++)
+        frames[i].flags = MEMM_FRAME_FLAG_RESERVED;
+}
+
+buddy_zone_t *buddy_zone_new(buddy_allocator_t *allocator, usize start_pfn, usize end_pfn)
+{
+    if (allocator->zone_amount == BUDDY_ZONE_MAX)
+        return nullptr;
+    buddy_zone_t *zone = &allocator->zones[allocator->zone_amount];
+    zone->start_pfn = start_pfn;
+    zone->end_pfn = min(end_pfn, allocator->frame_amount);
+    for (usize i = 0; i < KERNEL_CPU_MAX; i++)
+    {
+        zone->pcp[i].high = BUDDY_PCP_HIGH;
+        zone->pcp[i].batch = BUDDY_PCP_BATCH;
+    }
+    for (usize pfn = zone->start_pfn; pfn < zone->end_pfn; pfn++)
+        allocator->frames[pfn].zone = allocator->zone_amount;
+    allocator->zone_amount++;
+    return zone;
+}
+
+// 在调用前需要获得zone->lock
+static void buddy_free_block(buddy_allocator_t *allocator, buddy_zone_t *zone, usize pfn, usize order)
+{
+    memm_frame_t *frames = allocator->frames;
+    zone->free_pages += (usize)1 << order;
+    while (order < BUDDY_MAX_ORDER)
+    {
+        usize buddy = pfn ^ ((usize)1 << order);
+        if (buddy < zone->start_pfn ||
+            buddy + ((usize)1 << order) > zone->end_pfn ||
+            !(frames[buddy].flags & MEMM_FRAME_FLAG_FREE) ||
+            frames[buddy].order != order ||
+            frames[buddy].zone != frames[pfn].zone)
+            break;
+        buddy_list_remove(frames, &zone->free_area[order], buddy);
+        frames[buddy].flags &= ~MEMM_FRAME_FLAG_FREE;
+        pfn = min(pfn, buddy);
+        order++;
+    }
+    frames[pfn].flags = MEMM_FRAME_FLAG_FREE;
+    frames[pfn].order = order;
+    buddy_list_push_front(frames, &zone->free_area[order], pfn);
+}
+
+// 在调用前需要获得zone->lock
+static usize buddy_allocate_block(buddy_allocator_t *allocator, buddy_zone_t *zone, usize order)
+{
+    memm_frame_t *frames = allocator->frames;
+    usize o = order;
+    while (o <= BUDDY_MAX_ORDER && zone->free_area[o].count == 0)
+        o++;
+    if (o > BUDDY_MAX_ORDER)
+        return BUDDY_NULL_PFN;
+
+    usize pfn = zone->free_area[o].head;
+    buddy_list_remove(frames, &zone->free_area[o], pfn);
+    // 把多余的一半依次放回低一阶的空闲链表
+    while (o > order)
+    {
+        o--;
+        usize buddy = pfn + ((usize)1 << o);
+        frames[buddy].flags = MEMM_FRAME_FLAG_FREE;
+        frames[buddy].order = o;
+        buddy_list_push_front(frames, &zone->free_area[o], buddy);
+    }
+    frames[pfn].flags = 0;
+    frames[pfn].order = order;
+    zone->free_pages -= (usize)1 << order;
+    return pfn;
+}
+
+void buddy_add_range(buddy_allocator_t *allocator, buddy_zone_t *zone, usize start_pfn, usize end_pfn)
+{
+    start_pfn = max(start_pfn, zone->start_pfn);
+    end_pfn = min(end_pfn, zone->end_pfn);
+    simple_lock_lock(zone->lock);
+    while (start_pfn < end_pfn)
+    {
+        // 取以start_pfn对齐且不超过范围的最大块
+        usize order = 0;
+        while (order < BUDDY_MAX_ORDER &&
+               (start_pfn & ((usize)1 << order)) == 0 &&
+               start_pfn + ((usize)2 << order) <= end_pfn)
+            order++;
+        for (usize i = 0; i < ((usize)1 << order); i++)
+            allocator->frames[start_pfn + i].flags = 0;
+        buddy_free_block(allocator, zone, start_pfn, order);
+        start_pfn += (usize)1 << order;
+    }
+    simple_lock_unlock(zone->lock);
+}
+
+u64 buddy_allocate(buddy_allocator_t *allocator, buddy_zone_t *zone, usize order, bool cold)
+{
+    if (order > BUDDY_MAX_ORDER)
+        return 0;
+    memm_frame_t *frames = allocator->frames;
+    usize pfn;
+    if (order != 0)
+    {
+        simple_lock_lock(zone->lock);
+        pfn = buddy_allocate_block(allocator, zone, order);
+        simple_lock_unlock(zone->lock);
+        return buddy_pfn_to_phys(pfn);
+    }
+
+    buddy_pcp_t *pcp = &zone->pcp[kernel_cpu_id()];
+    if (pcp->list.count == 0)
+    { // 从伙伴系统批量补充
+        simple_lock_lock(zone->lock);
+        for (usize i = 0; i < pcp->batch; i++)
+        {
+            pfn = buddy_allocate_block(allocator, zone, 0);
+            if (pfn == BUDDY_NULL_PFN)
+                break;
+            frames[pfn].flags = MEMM_FRAME_FLAG_PCP;
+            buddy_list_push_back(frames, &pcp->list, pfn);
+        }
+        simple_lock_unlock(zone->lock);
+        if (pcp->list.count == 0)
+            return 0;
+    }
+    pfn = cold ? pcp->list.tail : pcp->list.head;
+    buddy_list_remove(frames, &pcp->list, pfn);
+    frames[pfn].flags = 0;
+    return buddy_pfn_to_phys(pfn);
+}
+
+void buddy_free(buddy_allocator_t *allocator, u64 physical, usize order, bool cold)
+{
+    usize pfn = buddy_phys_to_pfn(physical);
+    if (pfn == BUDDY_NULL_PFN || pfn >= allocator->frame_amount || order > BUDDY_MAX_ORDER)
+        return;
+    memm_frame_t *frames = allocator->frames;
+    if (frames[pfn].flags & (MEMM_FRAME_FLAG_FREE | MEMM_FRAME_FLAG_PCP | MEMM_FRAME_FLAG_RESERVED))
+        return;
+    buddy_zone_t *zone = &allocator->zones[frames[pfn].zone];
+    if (order != 0)
+    {
+        simple_lock_lock(zone->lock);
+        buddy_free_block(allocator, zone, pfn, order);
+        simple_lock_unlock(zone->lock);
+        return;
+    }
+
+    buddy_pcp_t *pcp = &zone->pcp[kernel_cpu_id()];
+    frames[pfn].flags = MEMM_FRAME_FLAG_PCP;
+    if (cold)
+        buddy_list_push_back(frames, &pcp->list, pfn);
+    else
+        buddy_list_push_front(frames, &pcp->list, pfn);
+    if (pcp->list.count > pcp->high)
+    { // 把冷端的页框归还伙伴系统
+        simple_lock_lock(zone->lock);
+        for (usize i = 0; i < pcp->batch && pcp->list.count != 0; i++)
+        {
+            usize tail = pcp->list.tail;
+            buddy_list_remove(frames, &pcp->list, tail);
+            frames[tail].flags = 0;
+            buddy_free_block(allocator, zone, tail, 0);
+        }
+        simple_lock_unlock(zone->lock);
+    }
+}
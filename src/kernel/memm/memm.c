@@ -1,12 +1,17 @@
 #include <kernel/kernel.h>
 #include <kernel/memm.h>
 #include <kernel/memm/allocator/raw.h>
+#include <kernel/memm/allocator/slab.h>
+#include <kernel/memm/allocator/tlsf.h>
 
 #include <libk/string.h>
 #include <libk/bits.h>
+#include <libk/math.h>
 
 memory_manager_t memory_manager;
 
+buddy_allocator_t frame_allocator;
+
 memory_manager_t *memm_new(usize mem_size)
 {
     memset(&memory_manager, 0, sizeof(memory_manager));
@@ -17,12 +22,24 @@ memory_manager_t *memm_new(usize mem_size)
     usize kernel_initial_size = (usize)&kend;
     align_to(kernel_initial_size, MEMM_PAGE_SIZE);
 
+    allocator_t *slab_allocator = memm_allocator_new(
+        (void *)kernel_initial_size,
+        MEMM_KERNEL_SLAB_SIZE,
+        MEMM_SLAB_ALLOCATOR, 0);
+    kernel_initial_size += MEMM_KERNEL_SLAB_SIZE;
+
     allocator_t *allocator0 = memm_allocator_new(
         (void *)kernel_initial_size,
         memory_manager.alloc_only_memory - MEMM_PAGE_TABLE_AREA_MAX - kernel_initial_size,
-        MEMM_RAW_ALLOCATOR, 0);
+        MEMM_KERNEL_ALLOCATOR, 0);
 
+    memory_manager.kernel_slab_allocator = slab_allocator;
     memory_manager.kernel_base_allocator = allocator0;
+    memory_manager.stat.slab.capacity = slab_allocator->size;
+    memory_manager.stat.base.capacity = allocator0->size;
+
+    itree_pool_new(&memory_manager.region_pool, MEMM_TAG_REGION);
+    itree_new(&memory_manager.lazy_regions, 0, ~(usize)0, &memory_manager.region_pool);
 
     return &memory_manager;
 }
@@ -39,51 +56,738 @@ allocator_t *memm_allocator_new(void *start, usize length, usize type, usize pid
     allocator->full = false;
     allocator->size = length;
     allocator->type = type;
+    allocator->prev = allocator->next = nullptr;
+    allocator->used = 0;
+    allocator->physical = 0;
+    allocator->order = 0;
     switch (type)
     {
     case MEMM_RAW_ALLOCATOR:
         raw_allocator_new((void *)allocator->allocator_instance, length - sizeof(allocator_t));
         allocator->allocate = (memm_allocate_t)raw_allocator_allocate;
         allocator->free = (memm_free_t)raw_allocator_free;
+        allocator->usable_size = (memm_usable_size_t)raw_allocator_usable_size;
+        allocator->free_sized = nullptr;
+        break;
+    case MEMM_SLAB_ALLOCATOR:
+        slab_allocator_new((void *)allocator->allocator_instance, length - sizeof(allocator_t));
+        allocator->allocate = (memm_allocate_t)slab_allocator_allocate;
+        allocator->free = (memm_free_t)slab_allocator_free;
+        allocator->usable_size = (memm_usable_size_t)slab_allocator_usable_size;
+        allocator->free_sized = (memm_free_sized_t)slab_allocator_free_sized;
+        break;
+    case MEMM_TLSF_ALLOCATOR:
+        tlsf_allocator_new((void *)allocator->allocator_instance, length - sizeof(allocator_t));
+        allocator->allocate = (memm_allocate_t)tlsf_allocator_allocate;
+        allocator->free = (memm_free_t)tlsf_allocator_free;
+        allocator->usable_size = (memm_usable_size_t)tlsf_allocator_usable_size;
+        allocator->free_sized = nullptr;
         break;
     default:
         allocator->magic = 0;
         break;
     }
+    return allocator;
+}
+
+// 分配器所在的分配器链的统计
+static memm_allocator_stat_t *memm_allocator_stat(allocator_t *allocator)
+{
+    return allocator->type == MEMM_SLAB_ALLOCATOR ? &memory_manager.stat.slab : &memory_manager.stat.base;
+}
+
+// 可用大小为size的内存块在分配器链的大小分布中的位置
+static usize memm_stat_bucket(usize size)
+{
+    if (size < 32)
+        return 0;
+    return min(bit_scan_reverse(size) - 4, MEMM_STAT_HISTOGRAM_SIZE - 1);
 }
 
 void memm_allocator_destruct(allocator_t *allocator)
 {
     allocator->magic = 0;
-    // TODO 从分配器树中删除这个分配器
-    KERNEL_TODO();
+    if (allocator->prev != nullptr)
+        allocator->prev->next = allocator->next;
+    else if (allocator == memory_manager.kernel_base_allocator)
+        memory_manager.kernel_base_allocator = allocator->next;
+    else if (allocator == memory_manager.kernel_slab_allocator)
+        memory_manager.kernel_slab_allocator = allocator->next;
+    if (allocator->next != nullptr)
+        allocator->next->prev = allocator->prev;
+    allocator->prev = allocator->next = nullptr;
+    if (allocator == memory_manager.kernel_spare_allocator)
+        memory_manager.kernel_spare_allocator = nullptr;
+    if (allocator->physical != 0)
+    {
+        memm_allocator_stat(allocator)->capacity -= allocator->size;
+        memm_free_pages(allocator->physical, allocator->order, 0);
+    }
+}
+
+// 从页框分配器取得2^order页，在它们的直接映射中创建一个分配器并接在链头之后
+static allocator_t *memm_allocator_grow(allocator_t **chain, usize type, usize order)
+{
+    if (memory_manager.frame_allocator == nullptr || order > BUDDY_MAX_ORDER)
+        return nullptr;
+    u64 physical = memm_alloc_pages(order, 0);
+    if (physical == 0)
+        return nullptr;
+    usize length = (usize)MEMM_PAGE_SIZE << order;
+    allocator_t *allocator = memm_allocator_new(phys_to_virt(physical), length, type, 0);
+    allocator->physical = physical;
+    allocator->order = order;
+    memm_allocator_stat(allocator)->capacity += length;
+    if (*chain == nullptr)
+        *chain = allocator;
+    else
+    {
+        allocator->prev = *chain;
+        allocator->next = (*chain)->next;
+        if (allocator->next != nullptr)
+            allocator->next->prev = allocator;
+        (*chain)->next = allocator;
+    }
+    return allocator;
+}
+
+static void *memm_allocator_try(allocator_t *allocator, usize size, memm_tag tag)
+{
+    if (allocator->full)
+        return nullptr;
+    void *mem = allocator->allocate(allocator->allocator_instance, size);
+    if (mem == nullptr)
+    { // 只有完全没有可用空间时才标记为满，较小的请求仍可以尝试这个分配器
+        if (allocator->allocate(allocator->allocator_instance, 0) == nullptr)
+            allocator->full = true;
+        return nullptr;
+    }
+    ((usize *)mem)[-2] = (usize)allocator | tag;
+    if (allocator->used++ == 0 && allocator == memory_manager.kernel_spare_allocator)
+        memory_manager.kernel_spare_allocator = nullptr;
+    usize usable = allocator->usable_size(allocator->allocator_instance, mem);
+    memm_allocator_stat_t *stat = memm_allocator_stat(allocator);
+    stat->used += usable;
+    stat->histogram[memm_stat_bucket(usable)]++;
+    memm_stat_account(tag, usable, 1);
+    return mem;
+}
+
+static void *memm_chain_allocate(allocator_t **chain, usize type, usize size, usize grow_order, memm_tag tag)
+{
+    for (allocator_t *allocator = *chain; allocator != nullptr; allocator = allocator->next)
+    {
+        void *mem = memm_allocator_try(allocator, size, tag);
+        if (mem != nullptr)
+            return mem;
+    }
+    allocator_t *allocator = memm_allocator_grow(chain, type, grow_order);
+    if (allocator == nullptr)
+        return nullptr;
+    return memm_allocator_try(allocator, size, tag);
+}
+
+// 能在新的内核大分配器中分配size字节所需的阶
+static usize memm_kernel_heap_order(usize size)
+{
+    // 分级分配器查找空闲块时会把请求向上取整到下一级，额外预留1/8
+    usize need = size + size / 8 + sizeof(allocator_t) + sizeof(tlsf_allocator_t) + MEMM_PAGE_SIZE;
+    usize pages = (need + MEMM_PAGE_SIZE - 1) / MEMM_PAGE_SIZE;
+    usize order = MEMM_KERNEL_HEAP_GROW_ORDER;
+    while (((usize)1 << order) < pages)
+        order++;
+    return order;
+}
+
+void *memm_kernel_allocate(usize size, memm_tag tag)
+{
+    if (size == 0)
+        return nullptr;
+    void *res = nullptr;
+    if (size <= SLAB_KMALLOC_MAX)
+        res = memm_chain_allocate(
+            &memory_manager.kernel_slab_allocator, MEMM_SLAB_ALLOCATOR,
+            size, MEMM_KERNEL_HEAP_GROW_ORDER, tag);
+    if (res == nullptr)
+        res = memm_chain_allocate(
+            &memory_manager.kernel_base_allocator, MEMM_KERNEL_ALLOCATOR,
+            size, memm_kernel_heap_order(size), tag);
+    return res;
 }
 
-void *memm_kernel_allocate(usize size)
+void *memm_kernel_allocate_aligned(usize size, usize align, memm_tag tag)
 {
-    allocator_t *allocator = memory_manager.kernel_base_allocator;
-    return allocator->allocate(allocator->allocator_instance, size);
+    if (align <= MEMM_KERNEL_ALIGN)
+        return memm_kernel_allocate(size, tag);
+    if (size == 0 || (align & (align - 1)) != 0 || size + align < size)
+        return nullptr;
+    void *mem = memm_kernel_allocate(size + align - MEMM_KERNEL_ALIGN, tag);
+    if (mem == nullptr)
+        return nullptr;
+    usize res = (usize)mem;
+    align_to(res, align);
+    if (res != (usize)mem)
+    { // 对齐后的地址至少在mem之后16字节，记录分配器返回的地址
+        ((usize *)res)[-2] = ((usize *)mem)[-2] | MEMM_ALLOCATOR_OFFSET;
+        ((void **)res)[-1] = mem;
+    }
+    return (void *)res;
+}
+
+// 取得mem前记录的分配器，不是有效的分配器时返回nullptr
+static allocator_t *memm_owner(void *mem, usize *owner)
+{
+    *owner = ((usize *)mem)[-2];
+    allocator_t *allocator = (allocator_t *)(*owner & ~(MEMM_TAG_MASK | MEMM_ALLOCATOR_OFFSET));
+    if (allocator == nullptr || allocator->magic != MEMM_ALLOCATOR_MAGIC)
+        return nullptr;
+    return allocator;
+}
+
+// 分配器中可用大小为usable的内存已被释放，更新统计，分配器变为空时成为保留的空分配器
+static void memm_allocator_release(allocator_t *allocator, memm_tag tag, usize usable)
+{
+    memm_allocator_stat_t *stat = memm_allocator_stat(allocator);
+    stat->used -= usable;
+    stat->histogram[memm_stat_bucket(usable)]--;
+    memm_stat_account(tag, -(isize)usable, -1);
+    allocator->full = false;
+    if (--allocator->used == 0 && allocator->physical != 0)
+    {
+        allocator_t *spare = memory_manager.kernel_spare_allocator;
+        memory_manager.kernel_spare_allocator = allocator;
+        if (spare != nullptr)
+            memm_allocator_destruct(spare);
+    }
 }
 
 void memm_free(void *mem)
 {
-    allocator_t *allocator = memory_manager.kernel_base_allocator;
-    if (allocator->magic != MEMM_ALLOCATOR_MAGIC)
+    if (mem == nullptr)
+        return;
+    usize owner;
+    allocator_t *allocator = memm_owner(mem, &owner);
+    if (allocator == nullptr)
         return;
+    // 先清除分配器地址，重复释放时直接返回
+    ((usize *)mem)[-2] = 0;
+    if (owner & MEMM_ALLOCATOR_OFFSET)
+    { // 对齐得到的地址，释放分配器返回的地址
+        mem = ((void **)mem)[-1];
+        ((usize *)mem)[-2] = 0;
+    }
+    usize usable = allocator->usable_size(allocator->allocator_instance, mem);
     allocator->free(allocator->allocator_instance, mem);
-    if (allocator->full)
-        allocator->full = false;
+    memm_allocator_release(allocator, owner & MEMM_TAG_MASK, usable);
+}
+
+void memm_free_sized(void *mem, usize size)
+{
+    if (mem == nullptr)
+        return;
+    usize owner;
+    allocator_t *allocator = memm_owner(mem, &owner);
+    if (allocator == nullptr)
+        return;
+    if (allocator->free_sized == nullptr || (owner & MEMM_ALLOCATOR_OFFSET))
+    {
+        memm_free(mem);
+        return;
+    }
+    ((usize *)mem)[-2] = 0;
+    usize usable = allocator->free_sized(allocator->allocator_instance, mem, size);
+    memm_allocator_release(allocator, owner & MEMM_TAG_MASK, usable);
+}
+
+static void memm_pagetable_pool_grow(memm_pagetable_pool_t *pool)
+{
+    u64 physical = memm_alloc_pages(MEMM_PAGE_TABLE_GROW_ORDER, 0);
+    if (physical == 0)
+        return;
+    usize length = (usize)MEMM_PAGE_SIZE << MEMM_PAGE_TABLE_GROW_ORDER;
+    for (usize offset = 0; offset < length; offset += MEMM_PAGE_TABLE_SIZE)
+    {
+        void *table = phys_to_virt(physical + offset);
+        *(void **)table = pool->dirty;
+        pool->dirty = table;
+        pool->dirty_amount++;
+    }
+}
+
+// 从节点的清零页框池中取出一个页框，池为空时返回0
+static u64 memm_zero_pool_take(usize node)
+{
+    memm_zero_pool_t *pool = &memory_manager.zero_pools[node];
+    if (pool->pages == nullptr)
+    {
+        pool->misses++;
+        return 0;
+    }
+    void *page = pool->pages;
+    pool->pages = *(void **)page;
+    pool->amount--;
+    pool->hits++;
+    *(void **)page = nullptr;
+    return virt_to_phys(page);
+}
+
+// 把所有清零页框池中的页框还给页框分配器，返回归还的页框数量
+static usize memm_zero_pool_drain()
+{
+    usize amount = 0;
+    for (usize node = 0; node < memory_manager.numa.node_amount; node++)
+    {
+        memm_zero_pool_t *pool = &memory_manager.zero_pools[node];
+        while (pool->pages != nullptr)
+        {
+            void *page = pool->pages;
+            pool->pages = *(void **)page;
+            buddy_free(memory_manager.frame_allocator, virt_to_phys(page), 0, 0);
+            amount++;
+        }
+        pool->amount = 0;
+    }
+    return amount;
+}
+
+// 为当前处理器所在的节点补充最多`MEMM_ZERO_POOL_BATCH`个清零页框
+static void memm_zero_pool_refill()
+{
+    if (memory_manager.frame_allocator == nullptr)
+        return;
+    usize node = memm_numa_local_node();
+    memm_zero_pool_t *pool = &memory_manager.zero_pools[node];
+    for (usize i = 0; i < MEMM_ZERO_POOL_BATCH && pool->amount < MEMM_ZERO_POOL_TARGET; i++)
+    {
+        u64 physical = memm_alloc_pages_node(0, MEMM_FRAME_COLD, node);
+        if (physical == 0)
+            return;
+        void *page = phys_to_virt(physical);
+        clear_page_nontemporal(page);
+        *(void **)page = pool->pages;
+        pool->pages = page;
+        pool->amount++;
+    }
+}
+
+void memm_zero_pool_stat(memm_zero_pool_t *stat)
+{
+    memset(stat, 0, sizeof(memm_zero_pool_t));
+    for (usize node = 0; node < memory_manager.numa.node_amount; node++)
+    {
+        memm_zero_pool_t *pool = &memory_manager.zero_pools[node];
+        stat->amount += pool->amount;
+        stat->hits += pool->hits;
+        stat->misses += pool->misses;
+    }
 }
 
 void *memm_allcate_pagetable()
 {
-    if (memory_manager.page_table_area < MEMM_PAGE_TABLE_AREA_MAX)
+    memm_pagetable_pool_t *pool = &memory_manager.page_table_pool;
+    if (pool->zeroed == nullptr && pool->dirty == nullptr &&
+        memory_manager.page_table_area == MEMM_PAGE_TABLE_AREA_MAX)
+        memm_pagetable_pool_grow(pool);
+
+    void *table;
+    if (pool->zeroed != nullptr)
+    {
+        table = pool->zeroed;
+        pool->zeroed = *(void **)table;
+        pool->zeroed_amount--;
+        *(void **)table = nullptr;
+        memm_stat_account(MEMM_TAG_PAGE_TABLE, MEMM_PAGE_TABLE_SIZE, 1);
+        return table;
+    }
+    if (memory_manager.frame_allocator != nullptr)
+    {
+        u64 physical = memm_zero_pool_take(memm_numa_local_node());
+        if (physical != 0)
+        {
+            memm_stat_account(MEMM_TAG_PAGE_TABLE, MEMM_PAGE_TABLE_SIZE, 1);
+            return phys_to_virt(physical);
+        }
+    }
+    if (pool->dirty != nullptr)
+    {
+        table = pool->dirty;
+        pool->dirty = *(void **)table;
+        pool->dirty_amount--;
+    }
+    else if (memory_manager.page_table_area < MEMM_PAGE_TABLE_AREA_MAX)
     {
         memory_manager.page_table_area += MEMM_PAGE_TABLE_SIZE;
-        return memory_manager.alloc_only_memory - memory_manager.page_table_area;
+        table = (void *)memory_manager.alloc_only_memory - memory_manager.page_table_area;
     }
     else
+        return nullptr;
+    memset(table, 0, MEMM_PAGE_TABLE_SIZE);
+    memm_stat_account(MEMM_TAG_PAGE_TABLE, MEMM_PAGE_TABLE_SIZE, 1);
+    return table;
+}
+
+void memm_free_pagetable(void *table)
+{
+    memm_pagetable_pool_t *pool = &memory_manager.page_table_pool;
+    *(void **)table = pool->pending;
+    pool->pending = table;
+    memm_stat_account(MEMM_TAG_PAGE_TABLE, -(isize)MEMM_PAGE_TABLE_SIZE, -1);
+}
+
+void memm_pagetable_flushed()
+{
+    memm_pagetable_pool_t *pool = &memory_manager.page_table_pool;
+    while (pool->pending != nullptr)
+    {
+        void *table = pool->pending;
+        pool->pending = *(void **)table;
+        *(void **)table = pool->dirty;
+        pool->dirty = table;
+        pool->dirty_amount++;
+    }
+}
+
+void memm_idle()
+{
+    memm_pagetable_pool_t *pool = &memory_manager.page_table_pool;
+    for (usize i = 0; i < MEMM_PAGE_TABLE_ZERO_BATCH && pool->dirty != nullptr; i++)
+    {
+        void *table = pool->dirty;
+        pool->dirty = *(void **)table;
+        pool->dirty_amount--;
+        clear_page_nontemporal(table);
+        *(void **)table = pool->zeroed;
+        pool->zeroed = table;
+        pool->zeroed_amount++;
+    }
+    memm_zero_pool_refill();
+    memm_reclaim_idle();
+    memm_collapse_idle();
+}
+
+// 把[start, end)中除去保留区域以外的部分加入页框分配器，按页框所属的区域分段加入
+static void memm_frame_add_range(u64 start, u64 end, u64 (*reserved)[2], usize amount)
+{
+    for (usize i = 0; i < amount; i++)
+    {
+        if (start < reserved[i][1] && reserved[i][0] < end)
+        {
+            memm_frame_add_range(start, reserved[i][0], reserved + i + 1, amount - i - 1);
+            memm_frame_add_range(reserved[i][1], end, reserved + i + 1, amount - i - 1);
+            return;
+        }
+    }
+    align_to(start, MEMM_PAGE_SIZE);
+    end -= end % MEMM_PAGE_SIZE;
+    usize pfn = start / MEMM_PAGE_SIZE;
+    usize end_pfn = min(end / MEMM_PAGE_SIZE, frame_allocator.frame_amount);
+    while (pfn < end_pfn)
+    {
+        u8 zone = frame_allocator.frames[pfn].zone;
+        usize next = pfn + 1;
+        while (next < end_pfn && frame_allocator.frames[next].zone == zone)
+            next++;
+        buddy_add_range(&frame_allocator, &frame_allocator.zones[zone], pfn, next);
+        pfn = next;
+    }
+}
+
+// 把内存映射中的内存以2MB对齐映射到直接映射区域，能使用1GB页时使用1GB页
+static void memm_physmap_init(bootinfo_memory_map_t *meminfo)
+{
+    for (
+        bootinfo_memory_map_entry_t *it = meminfo->entries;
+        (void *)it < bootinfo_memory_map_end(meminfo);
+        it++)
+    {
+        // 可用内存与ACPI使用的内存
+        if (it->type != 1 && it->type != 3 && it->type != 4)
+            continue;
+        u64 start = it->base_addr & ~MEMM_2M_ALIGN_MASK;
+        u64 end = it->base_addr + it->length;
+        align_to(end, MEMM_2M_ALIGN_MASK + 1);
+        end = min(end, MEMM_MAX_SUPPORTED_MEMORY);
+        if (start < end)
+            memm_map_pageframes_to(
+                MEMM_PHYSMAP_BASE + start, start, end - start,
+                false, true, MEMM_MEMORY_TYPE_WB);
+    }
+    memm_physmap_ready = true;
+}
+
+void memm_frame_init(bootinfo_t *bootinfo)
+{
+    void **tags;
+    if (bootinfo_get_tag(bootinfo, BOOTINFO_MEMORY_MAP_TYPE, &tags) == 0)
+        return;
+    bootinfo_memory_map_t *meminfo = bootinfo_memory_map(tags[0]);
+
+    // 最高的可用内存地址决定页框描述符数量
+    usize frame_amount = 0;
+    for (
+        bootinfo_memory_map_entry_t *it = meminfo->entries;
+        (void *)it < bootinfo_memory_map_end(meminfo);
+        it++)
+    {
+        if (it->type == 1)
+            frame_amount = max(frame_amount, (it->base_addr + it->length) / MEMM_PAGE_SIZE);
+    }
+    frame_amount = min(frame_amount, MEMM_MAX_SUPPORTED_PAGES);
+    memm_physmap_init(meminfo);
+    if (frame_amount <= MEMM_ALLOC_ONLY_MEMORY / MEMM_PAGE_SIZE)
+        return;
+
+    usize frames_size = frame_amount * sizeof(memm_frame_t);
+    align_to(frames_size, MEMM_2M_ALIGN_MASK + 1);
+    u64 reserved[2][2] = {
+        {(u64)bootinfo->start, (u64)bootinfo->start + bootinfo->size},
+        {0, 0},
+    };
+
+    // 寻找放置页框描述符数组的空间，以2MB对齐以便用大页映射
+    for (
+        bootinfo_memory_map_entry_t *it = meminfo->entries;
+        (void *)it < bootinfo_memory_map_end(meminfo);
+        it++)
+    {
+        if (it->type != 1)
+            continue;
+        u64 start = max(it->base_addr, MEMM_ALLOC_ONLY_MEMORY);
+        align_to(start, MEMM_2M_ALIGN_MASK + 1);
+        if (start < reserved[0][1] && reserved[0][0] < start + frames_size)
+        {
+            start = reserved[0][1];
+            align_to(start, MEMM_2M_ALIGN_MASK + 1);
+        }
+        if (start + frames_size <= it->base_addr + it->length)
+        {
+            reserved[1][0] = start;
+            reserved[1][1] = start + frames_size;
+            break;
+        }
+    }
+    if (reserved[1][1] == 0)
+        return;
+
+    buddy_allocator_new(&frame_allocator, phys_to_virt(reserved[1][0]), frame_amount);
+    // 区域0覆盖所有可分配的页框，NUMA节点的区域覆盖在它上面
+    buddy_zone_new(
+        &frame_allocator,
+        MEMM_ALLOC_ONLY_MEMORY / MEMM_PAGE_SIZE, frame_amount);
+    memm_numa_init(&memory_manager.numa, &frame_allocator);
+
+    for (
+        bootinfo_memory_map_entry_t *it = meminfo->entries;
+        (void *)it < bootinfo_memory_map_end(meminfo);
+        it++)
+    {
+        if (it->type == 1)
+            memm_frame_add_range(it->base_addr, it->base_addr + it->length, reserved, 2);
+    }
+
+    usize page_amount = 0;
+    for (usize i = 0; i < memory_manager.numa.node_amount; i++)
+    {
+        memm_numa_node_t *node = &memory_manager.numa.nodes[i];
+        for (usize j = 0; j < node->zone_amount; j++)
+            node->page_amount += frame_allocator.zones[node->zones[j]].free_pages;
+        page_amount += node->page_amount;
+    }
+    memm_reclaim_init(&memory_manager.reclaim, page_amount);
+
+    memory_manager.frame_allocator = &frame_allocator;
+}
+
+u64 memm_alloc_pages(usize order, usize flags)
+{
+    return memm_alloc_pages_policy(order, flags, &memory_manager.numa_policy);
+}
+
+// 按节点的后备顺序从页框分配器分配
+static u64 memm_alloc_pages_fallback(usize order, usize flags, usize node)
+{
+    buddy_allocator_t *allocator = memory_manager.frame_allocator;
+    memm_numa_t *numa = &memory_manager.numa;
+    for (usize i = 0; i < numa->node_amount; i++)
+    {
+        memm_numa_node_t *fallback = &numa->nodes[numa->nodes[node].fallback[i]];
+        for (usize j = 0; j < fallback->zone_amount; j++)
+        {
+            u64 res = buddy_allocate(
+                allocator, &allocator->zones[fallback->zones[j]],
+                order, flags & MEMM_FRAME_COLD);
+            if (res != 0)
+                return res;
+        }
+    }
+    return 0;
+}
+
+u64 memm_alloc_pages_node(usize order, usize flags, usize node)
+{
+    if (memory_manager.frame_allocator == nullptr || node >= memory_manager.numa.node_amount)
+        return 0;
+    if ((flags & MEMM_FRAME_ZERO) && order == 0)
+    {
+        u64 res = memm_zero_pool_take(node);
+        if (res != 0)
+            return res;
+    }
+    u64 res = memm_alloc_pages_fallback(order, flags, node);
+    // 内存不足时先收回清零页框池中的页框，再直接回收
+    if (res == 0 && memm_zero_pool_drain() != 0)
+        res = memm_alloc_pages_fallback(order, flags, node);
+    if (res == 0 && !(flags & MEMM_FRAME_NORECLAIM) && memm_reclaim((usize)1 << order) != 0)
+        res = memm_alloc_pages_fallback(order, flags, node);
+    if (res != 0 && (flags & MEMM_FRAME_ZERO))
+        memset(phys_to_virt(res), 0, (usize)MEMM_PAGE_SIZE << order);
+    return res;
+}
+
+u64 memm_alloc_pages_policy(usize order, usize flags, memm_numa_policy_t *policy)
+{
+    if (memory_manager.frame_allocator == nullptr)
+        return 0;
+    usize node;
+    switch (policy->type)
+    {
+    case MEMM_NUMA_POLICY_PREFERRED:
+        node = policy->node < memory_manager.numa.node_amount
+                   ? policy->node
+                   : memm_numa_local_node();
+        break;
+    case MEMM_NUMA_POLICY_INTERLEAVE:
+        node = policy->next % memory_manager.numa.node_amount;
+        policy->next = node + 1;
+        break;
+    default:
+        node = memm_numa_local_node();
+        break;
+    }
+    return memm_alloc_pages_node(order, flags, node);
+}
+
+usize memm_numa_local_node()
+{
+    return memory_manager.numa.cpu_node[kernel_cpu_id()];
+}
+
+void memm_set_numa_policy(memm_numa_policy_t *policy)
+{
+    memory_manager.numa_policy = *policy;
+}
+
+void memm_free_pages(u64 physical, usize order, usize flags)
+{
+    buddy_allocator_t *allocator = memory_manager.frame_allocator;
+    if (allocator == nullptr)
+        return;
+    memm_frame_t *frame = memm_frame_get(physical);
+    if (frame != nullptr && (frame->flags & MEMM_FRAME_FLAG_ANONYMOUS))
+    {
+        memm_lru_del(physical);
+        frame->flags &= ~MEMM_FRAME_FLAG_ANONYMOUS;
+    }
+    buddy_free(allocator, physical, order, flags & MEMM_FRAME_COLD);
+}
+
+memm_frame_t *memm_frame_get(u64 physical)
+{
+    buddy_allocator_t *allocator = memory_manager.frame_allocator;
+    if (allocator == nullptr)
+        return nullptr;
+    usize pfn = buddy_phys_to_pfn(physical);
+    if (pfn == BUDDY_NULL_PFN || pfn >= allocator->frame_amount)
+        return nullptr;
+    memm_frame_t *frame = &allocator->frames[pfn];
+    if (frame->flags & (MEMM_FRAME_FLAG_FREE | MEMM_FRAME_FLAG_PCP | MEMM_FRAME_FLAG_RESERVED))
+        return nullptr;
+    return frame;
+}
+
+// 负责address的区域树：内核空间的区域是全局的，用户空间的区域属于当前地址空间
+static itree_t *memm_lazy_regions_of(u64 address)
+{
+    if (is_user_address(address))
+        return &memm_current_address_space()->regions;
+    return &memory_manager.lazy_regions;
+}
+
+itree_node_t *memm_lazy_region_insert(
+    itree_t *regions, u64 start, u64 end,
+    bool anonymous, u64 physical,
+    bool write, memm_memory_type type)
+{
+    memm_lazy_region_t *region = memm_kernel_allocate(sizeof(memm_lazy_region_t), MEMM_TAG_REGION);
+    if (region == nullptr)
+        return nullptr;
+    region->start = start;
+    region->end = end;
+    region->physical = anonymous ? 0 : physical;
+    region->anonymous = anonymous;
+    region->write = write;
+    region->type = type;
+    itree_node_t *node = itree_insert(regions, start, end, region);
+    if (node == nullptr)
+        memm_free(region);
+    return node;
+}
+
+bool memm_lazy_region_register(
+    u64 start, usize size,
+    bool anonymous, u64 physical,
+    bool write, memm_memory_type type)
+{
+    u64 end = start + size;
+    align_to(end, MEMM_PAGE_SIZE);
+    physical -= start & (MEMM_PAGE_SIZE - 1);
+    start &= ~((u64)MEMM_PAGE_SIZE - 1);
+    if (size == 0 || end < start)
+        return false;
+
+    if (is_user_address(start) != is_user_address(end - 1))
+        return false;
+    return memm_lazy_region_insert(
+               memm_lazy_regions_of(start), start, end,
+               anonymous, physical, write, type) != nullptr;
+}
+
+bool memm_lazy_populate(u64 address, bool write)
+{
+    itree_node_t *node = itree_find(memm_lazy_regions_of(address), address);
+    if (node == nullptr)
+        return false;
+    memm_lazy_region_t *region = node->data;
+    if (write && !region->write)
+        return false;
+
+    bool user = is_user_address(address);
+    u64 page = address & ~((u64)MEMM_PAGE_SIZE - 1);
+    if (region->anonymous)
+    {
+        u64 frame = memm_alloc_pages(0, MEMM_FRAME_ZERO);
+        if (frame == 0)
+            return false;
+        if (!memm_map_pageframes_to(page, frame, MEMM_PAGE_SIZE, user, region->write, region->type))
+        {
+            memm_free_pages(frame, 0, 0);
+            return false;
+        }
+        // 内核空间被所有地址空间共享
+        memm_lru_add(frame, user ? memm_current_address_space() : &memm_kernel_address_space, page);
+        return true;
+    }
+
+    usize size = MEMM_PAGE_SIZE;
+    usize large_size = (usize)MEMM_PAGE_SIZE_2M * MEMM_PAGE_SIZE;
+    u64 large = address & ~((u64)large_size - 1);
+    if (large >= region->start && large + large_size <= region->end &&
+        is_aligned((region->physical + (large - region->start)), large_size))
     {
-        // TODO
+        page = large;
+        size = large_size;
     }
+    return memm_map_pageframes_to(
+        page, region->physical + (page - region->start),
+        size, user, region->write, region->type);
 }
@@ -2,20 +2,73 @@ extern crate core;
 
 use core::{
     alloc::{GlobalAlloc, Layout},
+    mem::MaybeUninit,
     ptr::null_mut,
 };
 
+/// 与`kernel/memm/stat.h`中的`memm_tag`、`MEMM_TAG_AMOUNT`和`MEMM_STAT_HISTOGRAM_SIZE`相同。
+const MEMM_TAG_RUST: u32 = 3;
+/// 与`MEMM_KERNEL_ALIGN`相同，`memm_kernel_allocate`总能满足的对齐。
+const MEMM_KERNEL_ALIGN: usize = 16;
+pub const MEMM_TAG_AMOUNT: usize = 5;
+pub const MEMM_STAT_HISTOGRAM_SIZE: usize = 20;
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct MemmTagStat {
+    pub bytes: usize,
+    pub objects: usize,
+    pub peak: usize,
+}
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct MemmAllocatorStat {
+    pub capacity: usize,
+    pub used: usize,
+    pub histogram: [usize; MEMM_STAT_HISTOGRAM_SIZE],
+}
+
+/// 内核内存统计的快照，见`memm_stat_snapshot_t`。
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct MemmStatSnapshot {
+    pub tags: [MemmTagStat; MEMM_TAG_AMOUNT],
+    pub slab: MemmAllocatorStat,
+    pub base: MemmAllocatorStat,
+}
+
+impl MemmStatSnapshot {
+    /// 读取当前的内核内存统计，不会停止其它处理器。
+    pub fn now() -> Self {
+        let mut snapshot = MaybeUninit::<Self>::uninit();
+        unsafe {
+            memm_stat_snapshot(snapshot.as_mut_ptr());
+            snapshot.assume_init()
+        }
+    }
+}
+
 extern "C" {
-    fn memm_kernel_allocate(size: usize) -> *mut u8;
-    // pub fn memm_user_allocate(size: usize, pid: usize);
+    fn memm_kernel_allocate(size: usize, tag: u32) -> *mut u8;
+    fn memm_kernel_allocate_aligned(size: usize, align: usize, tag: u32) -> *mut u8;
+    pub fn memm_user_allocate(size: usize, pid: usize) -> *mut u8;
     fn memm_free(mem: *mut u8);
+    fn memm_free_sized(mem: *mut u8, size: usize);
+    pub fn memm_user_free(mem: *mut u8, pid: usize);
+    pub fn memm_idle();
+    fn memm_stat_snapshot(snapshot: *mut MemmStatSnapshot);
 }
 
 pub struct KernelAllocator {}
 
 unsafe impl GlobalAlloc for KernelAllocator {
     unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
-        let res = memm_kernel_allocate(layout.size());
+        let res = if layout.align() <= MEMM_KERNEL_ALIGN {
+            memm_kernel_allocate(layout.size(), MEMM_TAG_RUST)
+        } else {
+            memm_kernel_allocate_aligned(layout.size(), layout.align(), MEMM_TAG_RUST)
+        };
         if res == null_mut() {
             panic!(
                 "Kernel allocator failed to allocate {} byte(s) memory.",
@@ -25,8 +78,12 @@ unsafe impl GlobalAlloc for KernelAllocator {
         res
     }
 
-    unsafe fn dealloc(&self, ptr: *mut u8, _layout: Layout) {
-        memm_free(ptr);
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        if layout.align() <= MEMM_KERNEL_ALIGN {
+            memm_free_sized(ptr, layout.size());
+        } else {
+            memm_free(ptr);
+        }
     }
 }
 
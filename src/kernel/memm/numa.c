@@ -0,0 +1,123 @@
+#include <kernel/memm/numa.h>
+#include <kernel/acpi.h>
+
+#include <libk/string.h>
+#include <libk/math.h>
+
+// 邻近域domain对应的节点，不存在时创建，节点数量已满时并入节点0
+static usize numa_node_of(memm_numa_t *numa, u32 domain)
+{
+    for (usize i = 0; i < numa->node_amount; i++)
+        if (numa->nodes[i].domain == domain)
+            return i;
+    if (numa->node_amount == MEMM_NUMA_NODE_MAX)
+        return 0;
+    numa->nodes[numa->node_amount].domain = domain;
+    return numa->node_amount++;
+}
+
+static void numa_parse_srat(memm_numa_t *numa, buddy_allocator_t *allocator, acpi_srat_t *srat)
+{
+    buddy_zone_t *all = &allocator->zones[0];
+    void *end = (void *)srat + srat->header.length;
+    for (void *it = srat->entries; it + 2 <= end; it += ((u8 *)it)[1])
+    {
+        u8 type = ((u8 *)it)[0];
+        u8 length = ((u8 *)it)[1];
+        if (length < 2 || it + length > end)
+            break;
+        if (type == ACPI_SRAT_MEMORY && length >= sizeof(acpi_srat_memory_t))
+        {
+            acpi_srat_memory_t *memory = it;
+            if (!(memory->flags & ACPI_SRAT_ENABLED))
+                continue;
+            memm_numa_node_t *node = &numa->nodes[numa_node_of(numa, memory->domain)];
+            usize start_pfn = max(buddy_phys_to_pfn(memory->base + MEMM_PAGE_SIZE - 1), all->start_pfn);
+            usize end_pfn = min(buddy_phys_to_pfn(memory->base + memory->size), all->end_pfn);
+            if (start_pfn >= end_pfn || buddy_zone_new(allocator, start_pfn, end_pfn) == nullptr)
+                continue;
+            node->zones[node->zone_amount++] = allocator->zone_amount - 1;
+        }
+        else if (type == ACPI_SRAT_PROCESSOR && length >= sizeof(acpi_srat_processor_t))
+        {
+            acpi_srat_processor_t *processor = it;
+            if (!(processor->flags & ACPI_SRAT_ENABLED))
+                continue;
+            u32 domain = processor->domain_low |
+                         ((u32)processor->domain_high[0] << 8) |
+                         ((u32)processor->domain_high[1] << 16) |
+                         ((u32)processor->domain_high[2] << 24);
+            numa->apic_node[processor->apic_id] = numa_node_of(numa, domain);
+        }
+        else if (type == ACPI_SRAT_X2APIC && length >= sizeof(acpi_srat_x2apic_t))
+        {
+            acpi_srat_x2apic_t *processor = it;
+            if (!(processor->flags & ACPI_SRAT_ENABLED) || processor->x2apic_id >= 256)
+                continue;
+            numa->apic_node[processor->x2apic_id] = numa_node_of(numa, processor->domain);
+        }
+    }
+}
+
+static void numa_parse_slit(memm_numa_t *numa, acpi_slit_t *slit)
+{
+    u64 amount = slit->locality_amount;
+    if (amount > 256 || slit->header.length < sizeof(acpi_slit_t) + amount * amount)
+        return;
+    for (usize i = 0; i < numa->node_amount; i++)
+    {
+        for (usize j = 0; j < numa->node_amount; j++)
+        {
+            u64 from = numa->nodes[i].domain, to = numa->nodes[j].domain;
+            if (from < amount && to < amount)
+                numa->distance[i][j] = slit->distance[from * amount + to];
+        }
+    }
+}
+
+void memm_numa_init(memm_numa_t *numa, buddy_allocator_t *allocator)
+{
+    memset(numa, 0, sizeof(memm_numa_t));
+    acpi_srat_t *srat = (acpi_srat_t *)acpi_find_table("SRAT");
+    if (srat != nullptr)
+        numa_parse_srat(numa, allocator, srat);
+    if (numa->node_amount == 0)
+        numa->node_amount = 1;
+    // 区域0中只剩下SRAT没有描述的内存
+    memm_numa_node_t *node0 = &numa->nodes[0];
+    node0->zones[node0->zone_amount++] = 0;
+
+    for (usize i = 0; i < numa->node_amount; i++)
+        for (usize j = 0; j < numa->node_amount; j++)
+            numa->distance[i][j] = i == j ? MEMM_NUMA_LOCAL_DISTANCE : MEMM_NUMA_REMOTE_DISTANCE;
+    acpi_slit_t *slit = (acpi_slit_t *)acpi_find_table("SLIT");
+    if (slit != nullptr)
+        numa_parse_slit(numa, slit);
+
+    // 按距离插入排序，节点自身总是排在最前面
+    for (usize i = 0; i < numa->node_amount; i++)
+    {
+        u8 *fallback = numa->nodes[i].fallback;
+        fallback[0] = i;
+        usize amount = 1;
+        for (usize j = 0; j < numa->node_amount; j++)
+        {
+            if (j == i)
+                continue;
+            usize k = amount++;
+            while (k > 1 && numa->distance[i][fallback[k - 1]] > numa->distance[i][j])
+            {
+                fallback[k] = fallback[k - 1];
+                k--;
+            }
+            fallback[k] = j;
+        }
+    }
+
+    memm_numa_cpu_online(numa);
+}
+
+void memm_numa_cpu_online(memm_numa_t *numa)
+{
+    numa->cpu_node[kernel_cpu_id()] = numa->apic_node[kernel_apic_id() & 0xff];
+}
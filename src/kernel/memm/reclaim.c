@@ -0,0 +1,182 @@
+#include <kernel/memm/reclaim.h>
+#include <kernel/memm.h>
+#include <kernel/fpu.h>
+
+#include <libk/math.h>
+
+// 伙伴系统中空闲的页框数量，不包括每CPU链表中的页框
+static usize reclaim_free_pages()
+{
+    buddy_allocator_t *allocator = memm_get_manager()->frame_allocator;
+    usize amount = 0;
+    for (usize i = 0; i < allocator->zone_amount; i++)
+        amount += allocator->zones[i].free_pages;
+    return amount;
+}
+
+static inline buddy_list_t *reclaim_list_of(memm_reclaim_t *reclaim, memm_frame_t *frame)
+{
+    return (frame->flags & MEMM_FRAME_FLAG_ACTIVE) ? &reclaim->active : &reclaim->inactive;
+}
+
+// 把LRU链表中的页框pfn移到活跃或不活跃链表的头部
+static void reclaim_move(memm_reclaim_t *reclaim, usize pfn, bool active)
+{
+    memm_frame_t *frames = memm_get_manager()->frame_allocator->frames;
+    buddy_list_remove(frames, reclaim_list_of(reclaim, &frames[pfn]), pfn);
+    if (active)
+        frames[pfn].flags |= MEMM_FRAME_FLAG_ACTIVE;
+    else
+        frames[pfn].flags &= ~MEMM_FRAME_FLAG_ACTIVE;
+    buddy_list_push_front(frames, reclaim_list_of(reclaim, &frames[pfn]), pfn);
+}
+
+void memm_reclaim_init(memm_reclaim_t *reclaim, usize page_amount)
+{
+    reclaim->low = max(page_amount / MEMM_RECLAIM_LOW_DIVISOR, MEMM_RECLAIM_LOW_MIN);
+    reclaim->high = reclaim->low * 2;
+}
+
+void memm_lru_add(u64 physical, memm_address_space_t *space, u64 address)
+{
+    memm_frame_t *frame = memm_frame_get(physical);
+    if (frame == nullptr || (frame->flags & MEMM_FRAME_FLAG_LRU))
+        return;
+    memm_reclaim_t *reclaim = &memm_get_manager()->reclaim;
+    frame->flags |= MEMM_FRAME_FLAG_ANONYMOUS | MEMM_FRAME_FLAG_LRU;
+    frame->flags &= ~MEMM_FRAME_FLAG_ACTIVE;
+    frame->space = space;
+    frame->address = address;
+    buddy_list_push_front(
+        memm_get_manager()->frame_allocator->frames,
+        &reclaim->inactive, buddy_phys_to_pfn(physical));
+}
+
+void memm_lru_del(u64 physical)
+{
+    memm_frame_t *frame = memm_frame_get(physical);
+    if (frame == nullptr || !(frame->flags & MEMM_FRAME_FLAG_LRU))
+        return;
+    memm_reclaim_t *reclaim = &memm_get_manager()->reclaim;
+    buddy_list_remove(
+        memm_get_manager()->frame_allocator->frames,
+        reclaim_list_of(reclaim, frame), buddy_phys_to_pfn(physical));
+    frame->flags &= ~(MEMM_FRAME_FLAG_LRU | MEMM_FRAME_FLAG_ACTIVE);
+    frame->space = nullptr;
+}
+
+// 检查活跃链表尾部的最多amount个页框，没有被访问过的移入不活跃链表
+static void reclaim_age_active(memm_reclaim_t *reclaim, usize amount)
+{
+    memm_frame_t *frames = memm_get_manager()->frame_allocator->frames;
+    for (usize i = 0; i < amount && reclaim->active.count != 0; i++)
+    {
+        usize pfn = reclaim->active.tail;
+        u64 physical = buddy_pfn_to_phys(pfn);
+        reclaim->scanned++;
+        switch (memm_page_age(frames[pfn].space, frames[pfn].address, physical, false))
+        {
+        case MEMM_PAGE_STATE_GONE:
+            memm_lru_del(physical);
+            break;
+        case MEMM_PAGE_STATE_REFERENCED:
+            reclaim_move(reclaim, pfn, true);
+            break;
+        default:
+            reclaim_move(reclaim, pfn, false);
+            break;
+        }
+    }
+}
+
+// 检查不活跃链表尾部的最多amount个页框，回收没有被访问过的页框，返回回收的数量
+static usize reclaim_shrink_inactive(memm_reclaim_t *reclaim, usize amount)
+{
+    memm_frame_t *frames = memm_get_manager()->frame_allocator->frames;
+    usize res = 0;
+    // 换出时逐页检查全0与重复的页，整批只保存与恢复一次FPU状态，每一页的区间只是嵌套
+    bool fpu = kernel_fpu_begin();
+    for (usize i = 0; i < amount && reclaim->inactive.count != 0; i++)
+    {
+        usize pfn = reclaim->inactive.tail;
+        u64 physical = buddy_pfn_to_phys(pfn);
+        reclaim->scanned++;
+        switch (memm_page_age(frames[pfn].space, frames[pfn].address, physical, true))
+        {
+        case MEMM_PAGE_STATE_GONE:
+            memm_lru_del(physical);
+            break;
+        case MEMM_PAGE_STATE_REFERENCED:
+            reclaim_move(reclaim, pfn, true);
+            break;
+        case MEMM_PAGE_STATE_RECLAIMED:
+            // 没有被写入过的匿名页仍是全0的，再次访问时重新映射一个清零的页框即可
+            memm_free_pages(physical, 0, MEMM_FRAME_COLD);
+            res++;
+            break;
+        case MEMM_PAGE_STATE_DIRTY:
+            // 被写入过的页换出到压缩内存，无法换出时放回不活跃链表头部
+            if (memm_zram_swap_out(physical))
+            {
+                res++;
+                break;
+            }
+            reclaim_move(reclaim, pfn, false);
+            break;
+        default:
+            reclaim_move(reclaim, pfn, false);
+            break;
+        }
+    }
+    if (fpu)
+        kernel_fpu_end();
+    reclaim->reclaimed += res;
+    return res;
+}
+
+usize memm_reclaim(usize amount)
+{
+    memory_manager_t *manager = memm_get_manager();
+    if (manager->frame_allocator == nullptr)
+        return 0;
+    memm_reclaim_t *reclaim = &manager->reclaim;
+    usize res = 0;
+    for (memm_shrinker_t *shrinker = reclaim->shrinkers; shrinker != nullptr && res < amount; shrinker = shrinker->next)
+        res += shrinker->scan(amount - res);
+
+    usize budget = 2 * (reclaim->active.count + reclaim->inactive.count);
+    while (res < amount && budget != 0)
+    {
+        usize batch = min(budget, MEMM_RECLAIM_BATCH);
+        budget -= batch;
+        if (reclaim->inactive.count < reclaim->active.count)
+            reclaim_age_active(reclaim, batch);
+        res += reclaim_shrink_inactive(reclaim, batch);
+    }
+    return res;
+}
+
+void memm_reclaim_idle()
+{
+    memory_manager_t *manager = memm_get_manager();
+    if (manager->frame_allocator == nullptr)
+        return;
+    memm_reclaim_t *reclaim = &manager->reclaim;
+    usize free = reclaim_free_pages();
+    if (free < reclaim->low)
+        reclaim->pressure = true;
+    else if (free >= reclaim->high)
+        reclaim->pressure = false;
+
+    if (reclaim->pressure)
+        memm_reclaim(min(reclaim->high - free, MEMM_RECLAIM_BATCH));
+    else if (reclaim->inactive.count < reclaim->active.count)
+        reclaim_age_active(reclaim, MEMM_RECLAIM_BATCH);
+}
+
+void memm_shrinker_register(memm_shrinker_t *shrinker)
+{
+    memm_reclaim_t *reclaim = &memm_get_manager()->reclaim;
+    shrinker->next = reclaim->shrinkers;
+    reclaim->shrinkers = shrinker;
+}
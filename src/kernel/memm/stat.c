@@ -0,0 +1,33 @@
+#include <kernel/memm/stat.h>
+#include <kernel/memm.h>
+
+void memm_stat_account(memm_tag tag, isize bytes, isize objects)
+{
+    memm_tag_counter_t *counter = &memm_get_manager()->stat.cpu[kernel_cpu_id()][tag];
+    counter->bytes += bytes;
+    counter->objects += objects;
+    if (counter->bytes > counter->peak)
+        counter->peak = counter->bytes;
+}
+
+void memm_stat_snapshot(memm_stat_snapshot_t *snapshot)
+{
+    memm_stat_t *stat = &memm_get_manager()->stat;
+    for (usize tag = 0; tag < MEMM_TAG_AMOUNT; tag++)
+    {
+        isize bytes = 0, objects = 0, peak = 0;
+        for (usize cpu = 0; cpu < KERNEL_CPU_MAX; cpu++)
+        {
+            memm_tag_counter_t *counter = &stat->cpu[cpu][tag];
+            bytes += counter->bytes;
+            objects += counter->objects;
+            peak += counter->peak;
+        }
+        // 其它处理器正在更新时和可能暂时为负数
+        snapshot->tags[tag].bytes = bytes > 0 ? bytes : 0;
+        snapshot->tags[tag].objects = objects > 0 ? objects : 0;
+        snapshot->tags[tag].peak = peak > bytes ? peak : snapshot->tags[tag].bytes;
+    }
+    snapshot->slab = stat->slab;
+    snapshot->base = stat->base;
+}
@@ -0,0 +1,253 @@
+#include <kernel/memm/user.h>
+#include <kernel/memm.h>
+
+#include <libk/bits.h>
+#include <libk/math.h>
+
+static usize user_next_pid = 1;
+
+void memm_user_space_init(memm_address_space_t *space)
+{
+    space->pid = user_next_pid++;
+    itree_pool_new(&space->region_pool, MEMM_TAG_REGION);
+    itree_new(&space->regions, MEMM_USER_SPACE_START, MEMM_USER_SPACE_END, &space->region_pool);
+    itree_new(&space->heap, 0, 0, &space->region_pool);
+}
+
+void memm_user_space_destruct(memm_address_space_t *space)
+{
+    for (itree_node_t *node = itree_first(&space->regions); node != nullptr; node = itree_next(node))
+        memm_free(node->data);
+    itree_pool_destruct(&space->region_pool);
+}
+
+bool memm_user_space_clone(memm_address_space_t *space, memm_address_space_t *source)
+{
+    for (itree_node_t *node = itree_first(&source->regions); node != nullptr; node = itree_next(node))
+    {
+        memm_lazy_region_t *region = node->data;
+        if (memm_lazy_region_insert(
+                &space->regions, node->start, node->end,
+                region->anonymous, region->physical,
+                region->write, region->type) == nullptr)
+            return false;
+    }
+    itree_new(&space->heap, source->heap.start, source->heap.end, &space->region_pool);
+    for (itree_node_t *node = itree_first(&source->heap); node != nullptr; node = itree_next(node))
+        if (itree_insert(&space->heap, node->start, node->end, nullptr) == nullptr)
+            return false;
+    return true;
+}
+
+memm_address_space_t *memm_address_space_find(usize pid)
+{
+    for (memm_address_space_t *space = &memm_kernel_address_space; space != nullptr; space = space->next)
+        if (space->pid == pid)
+            return space;
+    return nullptr;
+}
+
+// 检查用户范围并把size向上取整到页，范围合法时写入结束地址
+static bool user_range(u64 address, usize size, u64 *end)
+{
+    if (size == 0 || size > MEMM_USER_SPACE_END - MEMM_USER_SPACE_START)
+        return false;
+    if (!is_aligned(address, MEMM_PAGE_SIZE))
+        return false;
+    align_to(size, MEMM_PAGE_SIZE);
+    if (address < MEMM_USER_SPACE_START || address + size > MEMM_USER_SPACE_END || address + size < address)
+        return false;
+    *end = address + size;
+    return true;
+}
+
+// 拆分包含at的区域，使at成为区域的边界
+static bool user_region_split(itree_t *regions, u64 at)
+{
+    itree_node_t *node = itree_find(regions, at);
+    if (node == nullptr || node->start == at)
+        return true;
+    memm_lazy_region_t *region = node->data;
+    memm_lazy_region_t *copy = memm_kernel_allocate(sizeof(memm_lazy_region_t), MEMM_TAG_REGION);
+    if (copy == nullptr)
+        return false;
+    itree_node_t *right = itree_split(regions, node, at);
+    if (right == nullptr)
+    {
+        memm_free(copy);
+        return false;
+    }
+    *copy = *region;
+    copy->start = at;
+    if (!copy->anonymous)
+        copy->physical += at - region->start;
+    region->end = at;
+    right->data = copy;
+    return true;
+}
+
+// 属性相同且物理地址连续时把node后紧接的区域并入node
+static bool user_region_merge(itree_t *regions, itree_node_t *node)
+{
+    itree_node_t *next = itree_next(node);
+    if (next == nullptr || next->start != node->end)
+        return false;
+    memm_lazy_region_t *region = node->data, *following = next->data;
+    if (region->anonymous != following->anonymous ||
+        region->write != following->write ||
+        region->type != following->type)
+        return false;
+    if (!region->anonymous && region->physical + (region->end - region->start) != following->physical)
+        return false;
+    region->end = following->end;
+    memm_free(following);
+    return itree_merge(regions, node);
+}
+
+u64 memm_user_map(memm_address_space_t *space, u64 address, usize size, usize flags)
+{
+    if (size == 0 || size > MEMM_USER_SPACE_END - MEMM_USER_SPACE_START)
+        return 0;
+    align_to(size, MEMM_PAGE_SIZE);
+    if (address == 0)
+    {
+        usize large = (usize)MEMM_PAGE_SIZE_2M * MEMM_PAGE_SIZE;
+        if (!itree_find_gap(&space->regions, size, size >= large ? large : MEMM_PAGE_SIZE, false, &address))
+            return 0;
+    }
+    else
+    {
+        u64 end;
+        if (!user_range(address, size, &end) || itree_first_overlap(&space->regions, address, end) != nullptr)
+            return 0;
+    }
+    if (memm_lazy_region_insert(
+            &space->regions, address, address + size,
+            true, 0, flags & MEMM_USER_MAP_WRITE, MEMM_MEMORY_TYPE_WB) == nullptr)
+        return 0;
+    return address;
+}
+
+bool memm_user_unmap(memm_address_space_t *space, u64 address, usize size)
+{
+    u64 end;
+    if (!user_range(address, size, &end))
+        return false;
+    if (!user_region_split(&space->regions, address) || !user_region_split(&space->regions, end))
+        return false;
+    itree_node_t *node = itree_first_overlap(&space->regions, address, end);
+    while (node != nullptr && node->start < end)
+    {
+        itree_node_t *next = itree_next(node);
+        memm_free(node->data);
+        itree_remove(&space->regions, node);
+        node = next;
+    }
+    return memm_space_unmap_pageframes(space, address, end - address);
+}
+
+bool memm_user_protect(memm_address_space_t *space, u64 address, usize size, usize flags)
+{
+    u64 end;
+    if (!user_range(address, size, &end))
+        return false;
+    u64 covered = address;
+    for (itree_node_t *node = itree_first_overlap(&space->regions, address, end);
+         node != nullptr && node->start < end;
+         node = itree_next(node))
+    {
+        if (node->start > covered)
+            return false;
+        covered = node->end;
+    }
+    if (covered < end)
+        return false;
+    if (!user_region_split(&space->regions, address) || !user_region_split(&space->regions, end))
+        return false;
+
+    bool write = flags & MEMM_USER_MAP_WRITE;
+    itree_node_t *first = itree_find(&space->regions, address);
+    for (itree_node_t *node = first; node != nullptr && node->start < end; node = itree_next(node))
+        ((memm_lazy_region_t *)node->data)->write = write;
+    bool res = memm_space_protect_pageframes(space, address, end - address, write);
+
+    itree_node_t *node = itree_prev(first);
+    if (node == nullptr)
+        node = first;
+    while (node != nullptr && node->start < end)
+    {
+        if (!user_region_merge(&space->regions, node))
+            node = itree_next(node);
+    }
+    return res;
+}
+
+void *memm_user_allocate(usize size, usize pid)
+{
+    memm_address_space_t *space = memm_address_space_find(pid);
+    if (space == nullptr || size == 0 || size > MEMM_USER_HEAP_SIZE)
+        return nullptr;
+    if (space->heap.end == 0)
+    {
+        u64 start = memm_user_map(space, 0, MEMM_USER_HEAP_SIZE, MEMM_USER_MAP_WRITE);
+        if (start == 0)
+            return nullptr;
+        itree_new(&space->heap, start, start + MEMM_USER_HEAP_SIZE, &space->region_pool);
+    }
+    align_to(size, MEMM_USER_HEAP_ALIGN);
+    u64 address;
+    if (!itree_find_gap(&space->heap, size, MEMM_USER_HEAP_ALIGN, false, &address) ||
+        itree_insert(&space->heap, address, address + size, nullptr) == nullptr)
+        return nullptr;
+    return (void *)address;
+}
+
+void memm_user_free(void *mem, usize pid)
+{
+    memm_address_space_t *space = memm_address_space_find(pid);
+    if (space == nullptr)
+        return;
+    itree_node_t *node = itree_find(&space->heap, (u64)mem);
+    if (node == nullptr || node->start != (u64)mem)
+        return;
+    itree_node_t *prev = itree_prev(node), *next = itree_next(node);
+    // 与空闲空间相接的完整的页不再被任何内存块使用
+    u64 low = prev != nullptr ? prev->end : space->heap.start;
+    u64 high = next != nullptr ? next->start : space->heap.end;
+    align_to(low, MEMM_PAGE_SIZE);
+    high &= ~((u64)MEMM_PAGE_SIZE - 1);
+    u64 start = node->start & ~((u64)MEMM_PAGE_SIZE - 1);
+    u64 end = node->end;
+    align_to(end, MEMM_PAGE_SIZE);
+    itree_remove(&space->heap, node);
+    start = max(start, low);
+    end = min(end, high);
+    if (start < end)
+        memm_space_unmap_pageframes(space, start, end - start);
+}
+
+u64 memm_syscall_mmap(u64 address, u64 size, u64 flags)
+{
+    return memm_user_map(memm_current_address_space(), address, size, flags);
+}
+
+u64 memm_syscall_munmap(u64 address, u64 size)
+{
+    return memm_user_unmap(memm_current_address_space(), address, size);
+}
+
+u64 memm_syscall_mprotect(u64 address, u64 size, u64 flags)
+{
+    return memm_user_protect(memm_current_address_space(), address, size, flags);
+}
+
+u64 memm_syscall_allocate(u64 size)
+{
+    return (u64)memm_user_allocate(size, memm_current_address_space()->pid);
+}
+
+u64 memm_syscall_free(u64 mem)
+{
+    memm_user_free((void *)mem, memm_current_address_space()->pid);
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include <kernel/memm/zram.h>
+#include <kernel/memm.h>
+#include <kernel/kernel.h>
+#include <kernel/fpu.h>
+
+#include <libk/lz4.h>
+#include <libk/string.h>
+
+// 压缩与比较时使用的缓冲区，页回收只在一个处理器上进行
+static u8 zram_buffer[MEMM_PAGE_SIZE];
+static u16 zram_table[LZ4_HASH_SIZE];
+
+static bool zram_page_is_zero(u64 *page)
+{
+    if (kernel_fpu_begin())
+    {
+        bool res = memm_zram_page_is_zero_simd(page);
+        kernel_fpu_end();
+        return res;
+    }
+    for (usize i = 0; i < MEMM_PAGE_SIZE / sizeof(u64); i++)
+        if (page[i] != 0)
+            return false;
+    return true;
+}
+
+static bool zram_page_equal(u64 *a, u64 *b)
+{
+    if (kernel_fpu_begin())
+    {
+        bool res = memm_zram_page_equal_simd(a, b);
+        kernel_fpu_end();
+        return res;
+    }
+    for (usize i = 0; i < MEMM_PAGE_SIZE / sizeof(u64); i++)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+// FNV-1a，按8字节计算
+static u64 zram_hash(u64 *page)
+{
+    u64 hash = 0xcbf29ce484222325;
+    for (usize i = 0; i < MEMM_PAGE_SIZE / sizeof(u64); i++)
+    {
+        hash ^= page[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+static inline void zram_partial_remove(memm_zram_t *zram, memm_zram_page_t *page)
+{
+    if (page->prev != nullptr)
+        page->prev->next = page->next;
+    else
+        zram->partial[page->class] = page->next;
+    if (page->next != nullptr)
+        page->next->prev = page->prev;
+}
+
+static inline void zram_partial_push(memm_zram_t *zram, memm_zram_page_t *page)
+{
+    page->prev = nullptr;
+    page->next = zram->partial[page->class];
+    if (page->next != nullptr)
+        page->next->prev = page;
+    zram->partial[page->class] = page;
+}
+
+static void *zram_object_alloc(memm_zram_t *zram, usize size)
+{
+    usize class = (size + MEMM_ZRAM_CLASS_SIZE - 1) / MEMM_ZRAM_CLASS_SIZE - 1;
+    memm_zram_page_t *page = zram->partial[class];
+    if (page == nullptr)
+    { // 在回收的过程中分配，不能再次触发回收
+        u64 physical = memm_alloc_pages(0, MEMM_FRAME_NORECLAIM);
+        if (physical == 0)
+            return nullptr;
+        page = phys_to_virt(physical);
+        page->class = class;
+        page->inuse = 0;
+        page->free = nullptr;
+        usize slot = (class + 1) * MEMM_ZRAM_CLASS_SIZE;
+        for (usize i = (MEMM_PAGE_SIZE - sizeof(memm_zram_page_t)) / slot; i != 0; i--)
+        {
+            void *object = (void *)page + sizeof(memm_zram_page_t) + (i - 1) * slot;
+            *(void **)object = page->free;
+            page->free = object;
+        }
+        zram_partial_push(zram, page);
+        zram->arena_pages++;
+    }
+    void *object = page->free;
+    page->free = *(void **)object;
+    page->inuse++;
+    if (page->free == nullptr)
+        zram_partial_remove(zram, page);
+    return object;
+}
+
+static void zram_object_free(memm_zram_t *zram, void *object)
+{
+    memm_zram_page_t *page = (memm_zram_page_t *)((u64)object & ~((u64)MEMM_PAGE_SIZE - 1));
+    bool full = page->free == nullptr;
+    *(void **)object = page->free;
+    page->free = object;
+    page->inuse--;
+    if (page->inuse == 0)
+    {
+        if (!full)
+            zram_partial_remove(zram, page);
+        memm_free_pages(virt_to_phys(page), 0, 0);
+        zram->arena_pages--;
+    }
+    else if (full)
+        zram_partial_push(zram, page);
+}
+
+// 保存页框physical的内容，返回项，无法保存时返回nullptr
+static memm_zram_entry_t *zram_store(memm_zram_t *zram, u64 physical)
+{
+    u64 *page = phys_to_virt(physical);
+    if (zram_page_is_zero(page))
+    {
+        zram->zero.refcount++;
+        zram->stored_pages++;
+        return &zram->zero;
+    }
+
+    u64 hash = zram_hash(page);
+    memm_zram_entry_t **bucket = &zram->buckets[hash % MEMM_ZRAM_HASH_BUCKETS];
+    for (memm_zram_entry_t *entry = *bucket; entry != nullptr; entry = entry->next)
+    {
+        if (entry->hash == hash &&
+            lz4_decompress(entry->data, entry->size, zram_buffer, MEMM_PAGE_SIZE) &&
+            zram_page_equal((u64 *)zram_buffer, page))
+        {
+            entry->refcount++;
+            zram->stored_pages++;
+            zram->deduplicated++;
+            return entry;
+        }
+    }
+
+    usize size = lz4_compress(
+        page, MEMM_PAGE_SIZE,
+        zram_buffer, MEMM_ZRAM_OBJECT_MAX - sizeof(memm_zram_entry_t),
+        zram_table);
+    if (size == 0)
+    {
+        zram->rejected++;
+        return nullptr;
+    }
+    memm_zram_entry_t *entry = zram_object_alloc(zram, sizeof(memm_zram_entry_t) + size);
+    if (entry == nullptr)
+        return nullptr;
+    entry->hash = hash;
+    entry->refcount = 1;
+    entry->size = size;
+    memcpy(entry->data, zram_buffer, size);
+    entry->next = *bucket;
+    *bucket = entry;
+    zram->stored_pages++;
+    zram->unique_pages++;
+    zram->compressed_bytes += size;
+    return entry;
+}
+
+bool memm_zram_swap_out(u64 physical)
+{
+    memm_frame_t *frame = memm_frame_get(physical);
+    if (frame == nullptr || !(frame->flags & MEMM_FRAME_FLAG_LRU))
+        return false;
+    memm_address_space_t *space = frame->space;
+    u64 address = frame->address;
+    // 先取消映射，压缩期间页不会被修改
+    u64 pte = memm_page_isolate(space, address, physical);
+    if (pte == 0)
+        return false;
+    memm_zram_entry_t *entry = zram_store(&memm_get_manager()->zram, physical);
+    if (entry == nullptr)
+    {
+        memm_page_install(space, address, pte);
+        return false;
+    }
+    memm_page_install(space, address, memm_swap_entry_make(pte, entry));
+    memm_free_pages(physical, 0, MEMM_FRAME_COLD);
+    return true;
+}
+
+u64 memm_zram_fault(void *entry)
+{
+    memm_zram_t *zram = &memm_get_manager()->zram;
+    memm_zram_entry_t *zentry = entry;
+    u64 start = kernel_rdtsc();
+    u64 physical;
+    if (zentry == &zram->zero)
+        physical = memm_alloc_pages(0, MEMM_FRAME_ZERO);
+    else
+    {
+        physical = memm_alloc_pages(0, 0);
+        if (physical != 0 &&
+            !lz4_decompress(zentry->data, zentry->size, phys_to_virt(physical), MEMM_PAGE_SIZE))
+        {
+            memm_free_pages(physical, 0, 0);
+            physical = 0;
+        }
+    }
+    if (physical == 0)
+        return 0;
+    u64 cycles = kernel_rdtsc() - start;
+    zram->faults++;
+    zram->fault_cycles += cycles;
+    if (cycles > zram->fault_cycles_max)
+        zram->fault_cycles_max = cycles;
+    return physical;
+}
+
+void memm_zram_get(void *entry)
+{
+    ((memm_zram_entry_t *)entry)->refcount++;
+    memm_get_manager()->zram.stored_pages++;
+}
+
+void memm_zram_put(void *entry)
+{
+    memm_zram_t *zram = &memm_get_manager()->zram;
+    memm_zram_entry_t *zentry = entry;
+    zram->stored_pages--;
+    if (--zentry->refcount != 0 || zentry == &zram->zero)
+        return;
+    memm_zram_entry_t **it = &zram->buckets[zentry->hash % MEMM_ZRAM_HASH_BUCKETS];
+    while (*it != zentry)
+        it = &(*it)->next;
+    *it = zentry->next;
+    zram->unique_pages--;
+    zram->compressed_bytes -= zentry->size;
+    zram_object_free(zram, zentry);
+}
+
+void memm_zram_stat(memm_zram_stat_t *stat)
+{
+    memm_zram_t *zram = &memm_get_manager()->zram;
+    stat->stored_pages = zram->stored_pages;
+    stat->unique_pages = zram->unique_pages;
+    stat->zero_pages = zram->zero.refcount;
+    stat->compressed_bytes = zram->compressed_bytes;
+    stat->arena_pages = zram->arena_pages;
+    stat->deduplicated = zram->deduplicated;
+    stat->rejected = zram->rejected;
+    stat->ratio = zram->arena_pages == 0 ? 0 : zram->stored_pages * 100 / zram->arena_pages;
+    stat->faults = zram->faults;
+    stat->fault_cycles_avg = zram->faults == 0 ? 0 : zram->fault_cycles / zram->faults;
+    stat->fault_cycles_max = zram->fault_cycles_max;
+}
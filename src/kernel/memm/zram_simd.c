@@ -0,0 +1,32 @@
+#include <kernel/memm/zram.h>
+#include <kernel/memm.h>
+
+// 此文件使用SSE2编译，见Makefile中的SIMD_C_SRCS
+
+// 16字节的向量，按8字节对齐，可以用于没有按16字节对齐的缓冲区
+typedef u64 zram_vector_t __attribute__((vector_size(16), aligned(8)));
+
+bool memm_zram_page_is_zero_simd(u64 *page)
+{
+    zram_vector_t *v = (zram_vector_t *)page;
+    for (usize i = 0; i < MEMM_PAGE_SIZE / sizeof(zram_vector_t); i += 4)
+    {
+        zram_vector_t x = v[i] | v[i + 1] | v[i + 2] | v[i + 3];
+        if ((x[0] | x[1]) != 0)
+            return false;
+    }
+    return true;
+}
+
+bool memm_zram_page_equal_simd(u64 *a, u64 *b)
+{
+    zram_vector_t *va = (zram_vector_t *)a, *vb = (zram_vector_t *)b;
+    for (usize i = 0; i < MEMM_PAGE_SIZE / sizeof(zram_vector_t); i += 4)
+    {
+        zram_vector_t x = (va[i] ^ vb[i]) | (va[i + 1] ^ vb[i + 1]) |
+                          (va[i + 2] ^ vb[i + 2]) | (va[i + 3] ^ vb[i + 3]);
+        if ((x[0] | x[1]) != 0)
+            return false;
+    }
+    return true;
+}
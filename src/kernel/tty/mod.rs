@@ -16,9 +16,13 @@ macro_rules! message {
                 Color,
                 format_message
             },
-            libk::alloc::vec::Vec,
+            libk::alloc::{arena::Arena, vec::Vec},
         };
-        let mut formatter = $fmtter.chars().collect::<Vec<char>>();
+        let arena = Arena::new();
+        let mut formatter = Vec::new_in(&arena);
+        for c in $fmtter.chars() {
+            formatter.push(c);
+        }
         let builder = MessageBuilder::new();
         $(
             let builder = builder.append(format_message(&mut formatter, $e));
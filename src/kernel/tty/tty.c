@@ -22,7 +22,7 @@ tty *tty_new(tty_type type, tty_mode mode)
     {
         if (tty_ctrler.map[i] == false)
         {
-            res = memm_kernel_allocate(sizeof(tty));
+            res = memm_kernel_allocate(sizeof(tty), MEMM_TAG_TTY);
             res->id = i;
             tty_ctrler.ttys[i] = res;
             tty_ctrler.map[i] = true;
@@ -76,7 +76,7 @@ inline static void scroll_buffer(
     void *buffer, usize width, usize height, usize pixsize,
     usize dist)
 {
-    memcpy(buffer, buffer + width * pixsize * dist, (height - dist) * width * pixsize);
+    memmove(buffer, buffer + width * pixsize * dist, (height - dist) * width * pixsize);
     memset(buffer + (height - dist) * width * pixsize, 0, dist * width * pixsize);
 }
 
@@ -1,6 +1,8 @@
 use core::ptr::null_mut;
 
 use crate::libk::alloc::{
+    alloc::Allocator,
+    arena::Arena,
     boxed::Box,
     string::{String, ToString},
     vec::Vec,
@@ -315,7 +317,11 @@ pub enum FmtMeta {
     Pointer(usize),
 }
 
-pub fn format_message(fmt: &mut Vec<char>, meta: FmtMeta) -> MessageBuilder {
+/// 用`meta`替换`fmt`中的第一个`{...}`，返回替换处之前的消息，`fmt`中保留剩余的部分。
+///
+/// 过程中的临时数组在`Arena`中分配，函数返回时一起释放。
+pub fn format_message<A: Allocator>(fmt: &mut Vec<char, A>, meta: FmtMeta) -> MessageBuilder {
+    let arena = Arena::new();
     let mut msgbuilder = MessageBuilder::new();
     let mut fmt_start = None;
     let mut fmt_end = None;
@@ -340,7 +346,7 @@ pub fn format_message(fmt: &mut Vec<char>, meta: FmtMeta) -> MessageBuilder {
     } else {
         let fmt_start = fmt_start.unwrap();
         let fmt_end = fmt_end.unwrap();
-        let mut formatter = Vec::new();
+        let mut formatter = Vec::new_in(&arena);
         for _ in fmt_start..=fmt_end {
             formatter.push(fmt.remove(fmt_start));
         }
@@ -378,7 +384,7 @@ pub fn format_message(fmt: &mut Vec<char>, meta: FmtMeta) -> MessageBuilder {
             }
         }
     }
-    let mut rests = Vec::new();
+    let mut rests = Vec::new_in(&arena);
     while !fmt.is_empty() && fmt[0] != '{' {
         rests.push(fmt.remove(0));
     }
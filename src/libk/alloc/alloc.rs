@@ -1,6 +1,6 @@
 use core::alloc::{GlobalAlloc, Layout};
 
-use crate::kernel::memm::memm::KERNEL_ALLOCATOR;
+use crate::{kernel::memm::memm::KERNEL_ALLOCATOR, libk::core::ptr::PtrOptions};
 
 pub unsafe fn alloc(layout: Layout) -> *mut u8 {
     KERNEL_ALLOCATOR.alloc(layout)
@@ -9,3 +9,32 @@ pub unsafe fn alloc(layout: Layout) -> *mut u8 {
 pub unsafe fn dealloc(ptr: *mut u8, layout: Layout) {
     KERNEL_ALLOCATOR.dealloc(ptr, layout);
 }
+
+/// 集合使用的分配器。
+///
+/// `grow`把`ptr`处按`old`分配的内存扩展为`new`，默认分配新的内存并复制，分配器可以原地扩展。
+pub trait Allocator {
+    unsafe fn allocate(&self, layout: Layout) -> *mut u8;
+    unsafe fn deallocate(&self, ptr: *mut u8, layout: Layout);
+
+    unsafe fn grow(&self, ptr: *mut u8, old: Layout, new: Layout) -> *mut u8 {
+        let res = self.allocate(new);
+        res.kcopy_from(ptr, old.size());
+        self.deallocate(ptr, old);
+        res
+    }
+}
+
+/// 内核分配器`KernelAllocator`，集合默认使用的分配器。
+#[derive(Clone, Copy, Default)]
+pub struct Global;
+
+impl Allocator for Global {
+    unsafe fn allocate(&self, layout: Layout) -> *mut u8 {
+        alloc(layout)
+    }
+
+    unsafe fn deallocate(&self, ptr: *mut u8, layout: Layout) {
+        dealloc(ptr, layout);
+    }
+}
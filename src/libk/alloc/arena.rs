@@ -0,0 +1,156 @@
+use core::{alloc::Layout, cell::Cell, mem::size_of, ptr::null_mut};
+
+use super::alloc::{alloc, dealloc, Allocator};
+
+/// 普通内存块的大小。
+pub const ARENA_CHUNK_SIZE: usize = 4096;
+
+/// 内存块的头部，位于内存块的开始。
+///
+/// `size`是包括头部在内的内存块大小，`next`是更早分配的内存块。
+struct ArenaChunk {
+    next: *mut ArenaChunk,
+    size: usize,
+}
+
+const ARENA_CHUNK_ALIGN: usize = 16;
+const ARENA_HEADER_SIZE: usize =
+    (size_of::<ArenaChunk>() + ARENA_CHUNK_ALIGN - 1) & !(ARENA_CHUNK_ALIGN - 1);
+
+/// 作用域内的临时分配器。
+///
+/// 从`ARENA_CHUNK_SIZE`大小的内存块中依次分配，单独的释放只在内存块是最后一次分配时回退，
+/// 其它内存在`reset`或`Arena`被丢弃时一起释放。超过`ARENA_CHUNK_SIZE / 4`字节的分配使用单独的内存块，
+/// 不浪费当前内存块的剩余空间。
+///
+/// 通过`&Arena`作为集合的分配器，如`Vec::new_in(&arena)`，集合不能比`Arena`活得更久。
+pub struct Arena {
+    chunks: Cell<*mut ArenaChunk>,
+    current: Cell<usize>,
+    end: Cell<usize>,
+}
+
+impl Arena {
+    pub const fn new() -> Self {
+        Self {
+            chunks: Cell::new(null_mut()),
+            current: Cell::new(0),
+            end: Cell::new(0),
+        }
+    }
+
+    unsafe fn new_chunk(&self, size: usize) -> *mut ArenaChunk {
+        let chunk: *mut ArenaChunk =
+            alloc(Layout::from_size_align_unchecked(size, ARENA_CHUNK_ALIGN)).cast();
+        if chunk.is_null() {
+            return chunk;
+        }
+        chunk.write(ArenaChunk {
+            next: self.chunks.get(),
+            size,
+        });
+        self.chunks.set(chunk);
+        chunk
+    }
+
+    unsafe fn free_chunk(chunk: *mut ArenaChunk) {
+        dealloc(
+            chunk.cast(),
+            Layout::from_size_align_unchecked((*chunk).size, ARENA_CHUNK_ALIGN),
+        );
+    }
+
+    /// 释放所有分配，保留一个普通内存块供之后使用。
+    pub fn reset(&mut self) {
+        let mut kept: *mut ArenaChunk = null_mut();
+        let mut chunk = self.chunks.get();
+        unsafe {
+            while !chunk.is_null() {
+                let next = (*chunk).next;
+                if kept.is_null() && (*chunk).size == ARENA_CHUNK_SIZE {
+                    kept = chunk;
+                    (*kept).next = null_mut();
+                } else {
+                    Self::free_chunk(chunk);
+                }
+                chunk = next;
+            }
+        }
+        self.chunks.set(kept);
+        if kept.is_null() {
+            self.current.set(0);
+            self.end.set(0);
+        } else {
+            self.current.set(kept as usize + ARENA_HEADER_SIZE);
+            self.end.set(kept as usize + ARENA_CHUNK_SIZE);
+        }
+    }
+}
+
+impl Default for Arena {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Drop for Arena {
+    fn drop(&mut self) {
+        let mut chunk = self.chunks.get();
+        while !chunk.is_null() {
+            unsafe {
+                let next = (*chunk).next;
+                Self::free_chunk(chunk);
+                chunk = next;
+            }
+        }
+    }
+}
+
+impl Allocator for &Arena {
+    unsafe fn allocate(&self, layout: Layout) -> *mut u8 {
+        let align = layout.align();
+        if layout.size() > ARENA_CHUNK_SIZE / 4 {
+            // 单独的内存块，不改变当前内存块
+            let chunk = self.new_chunk(ARENA_HEADER_SIZE + layout.size() + align);
+            if chunk.is_null() {
+                return null_mut();
+            }
+            let start = (chunk as usize + ARENA_HEADER_SIZE + align - 1) & !(align - 1);
+            return start as *mut u8;
+        }
+        let mut start = (self.current.get() + align - 1) & !(align - 1);
+        if self.current.get() == 0 || start + layout.size() > self.end.get() {
+            let chunk = self.new_chunk(ARENA_CHUNK_SIZE);
+            if chunk.is_null() {
+                return null_mut();
+            }
+            self.current.set(chunk as usize + ARENA_HEADER_SIZE);
+            self.end.set(chunk as usize + ARENA_CHUNK_SIZE);
+            start = (self.current.get() + align - 1) & !(align - 1);
+        }
+        self.current.set(start + layout.size());
+        start as *mut u8
+    }
+
+    unsafe fn deallocate(&self, ptr: *mut u8, layout: Layout) {
+        if ptr as usize + layout.size() == self.current.get() {
+            self.current.set(ptr as usize);
+        }
+    }
+
+    unsafe fn grow(&self, ptr: *mut u8, old: Layout, new: Layout) -> *mut u8 {
+        // 最后一次分配且当前内存块有足够空间时原地扩展
+        if ptr as usize + old.size() == self.current.get()
+            && ptr as usize & (new.align() - 1) == 0
+            && ptr as usize + new.size() <= self.end.get()
+        {
+            self.current.set(ptr as usize + new.size());
+            return ptr;
+        }
+        let res = self.allocate(new);
+        if !res.is_null() {
+            res.copy_from_nonoverlapping(ptr, old.size());
+        }
+        res
+    }
+}
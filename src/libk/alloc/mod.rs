@@ -1,4 +1,5 @@
 pub mod alloc;
+pub mod arena;
 pub mod boxed;
 pub mod string;
 pub mod vec;
@@ -1,38 +1,49 @@
 use core::{
     alloc::Layout,
+    mem::ManuallyDrop,
     ops::{Index, IndexMut, Range, RangeFull},
-    ptr::addr_of_mut,
+    ptr::{addr_of, addr_of_mut},
     slice,
 };
 
 use crate::libk::{
-    alloc::alloc::{alloc, dealloc},
+    alloc::alloc::{Allocator, Global},
     core::ptr::PtrOptions,
 };
 
-pub struct Vec<T> {
+/// 动态数组，内存来自分配器`A`，默认为内核分配器。
+pub struct Vec<T, A: Allocator = Global> {
     pointer: *mut T,
     length: usize,
     capacity: usize,
+    allocator: A,
 }
 
 impl<T: Default> Vec<T> {
     pub fn new() -> Self {
+        Self::new_in(Global)
+    }
+}
+
+impl<T: Default, A: Allocator> Vec<T, A> {
+    pub fn new_in(allocator: A) -> Self {
         Self {
-            pointer: unsafe { alloc(Layout::array::<T>(4).unwrap()).cast() },
+            pointer: unsafe { allocator.allocate(Layout::array::<T>(4).unwrap()).cast() },
             length: 0,
             capacity: 4,
+            allocator,
         }
     }
 
     unsafe fn extend_capacity(&mut self) {
-        let newp: *mut T = alloc(Layout::array::<T>(self.capacity * 2).unwrap()).cast();
-        self.pointer.kcopy_to(newp, self.length);
-        dealloc(
-            self.pointer.cast(),
-            Layout::array::<T>(self.capacity).unwrap(),
-        );
-        self.pointer = newp;
+        self.pointer = self
+            .allocator
+            .grow(
+                self.pointer.cast(),
+                Layout::array::<T>(self.capacity).unwrap(),
+                Layout::array::<T>(self.capacity * 2).unwrap(),
+            )
+            .cast();
         self.capacity *= 2;
     }
 
@@ -50,21 +61,15 @@ impl<T: Default> Vec<T> {
         }
         let rearlen = self.length - index;
         unsafe {
-            if rearlen != 0 {
-                let tmp = alloc(Layout::array::<T>(rearlen).unwrap()).cast();
-                self.pointer.offset(index as isize).kcopy_to(tmp, rearlen);
-                self.pointer.offset(index as isize).write(item);
-                self.pointer
-                    .offset(index as isize + 1)
-                    .kcopy_from(tmp, rearlen);
-            } else {
-                self.pointer.offset(self.length as isize).write(item);
-            }
+            self.pointer
+                .offset(index as isize + 1)
+                .kmove_from(self.pointer.offset(index as isize), rearlen);
+            self.pointer.offset(index as isize).write(item);
         }
         self.length += 1;
     }
 
-    pub fn append(&mut self, v: &mut Self) {
+    pub fn append<B: Allocator>(&mut self, v: &mut Vec<T, B>) {
         while self.capacity < self.length + v.length {
             unsafe { self.extend_capacity() }
         }
@@ -107,7 +112,7 @@ impl<T: Default> Vec<T> {
         let pt = addr_of_mut!(t);
         unsafe {
             pt.kcopy_from(self.pointer.offset(index as isize).cast_const(), 1);
-            self.pointer.offset(index as isize).kcopy_from(
+            self.pointer.offset(index as isize).kmove_from(
                 self.pointer.offset(index as isize + 1),
                 self.length - index - 1,
             );
@@ -132,7 +137,7 @@ impl<T: Default> Default for Vec<T> {
     }
 }
 
-impl<T: Default> Index<usize> for Vec<T> {
+impl<T: Default, A: Allocator> Index<usize> for Vec<T, A> {
     type Output = T;
 
     fn index(&self, index: usize) -> &Self::Output {
@@ -140,7 +145,7 @@ impl<T: Default> Index<usize> for Vec<T> {
     }
 }
 
-impl<T: Default> Index<Range<usize>> for Vec<T> {
+impl<T: Default, A: Allocator> Index<Range<usize>> for Vec<T, A> {
     type Output = [T];
 
     fn index(&self, index: Range<usize>) -> &Self::Output {
@@ -148,7 +153,7 @@ impl<T: Default> Index<Range<usize>> for Vec<T> {
     }
 }
 
-impl<T: Default> Index<RangeFull> for Vec<T> {
+impl<T: Default, A: Allocator> Index<RangeFull> for Vec<T, A> {
     type Output = [T];
 
     fn index(&self, _: RangeFull) -> &Self::Output {
@@ -156,18 +161,24 @@ impl<T: Default> Index<RangeFull> for Vec<T> {
     }
 }
 
-impl<T: Default> IndexMut<RangeFull> for Vec<T> {
+impl<T: Default, A: Allocator> IndexMut<RangeFull> for Vec<T, A> {
     fn index_mut(&mut self, _: RangeFull) -> &mut Self::Output {
         unsafe { slice::from_raw_parts_mut(self.pointer.cast(), self.length) }
     }
 }
 
-impl<T: Default> Clone for Vec<T> {
+impl<T: Default, A: Allocator + Clone> Clone for Vec<T, A> {
     fn clone(&self) -> Self {
+        let allocator = self.allocator.clone();
         let res = Self {
-            pointer: unsafe { alloc(Layout::array::<T>(self.capacity).unwrap()).cast() },
+            pointer: unsafe {
+                allocator
+                    .allocate(Layout::array::<T>(self.capacity).unwrap())
+                    .cast()
+            },
             length: self.length,
             capacity: self.capacity,
+            allocator,
         };
         unsafe {
             res.pointer
@@ -177,10 +188,10 @@ impl<T: Default> Clone for Vec<T> {
     }
 }
 
-impl<T> Drop for Vec<T> {
+impl<T, A: Allocator> Drop for Vec<T, A> {
     fn drop(&mut self) {
         unsafe {
-            dealloc(
+            self.allocator.deallocate(
                 self.pointer.cast(),
                 Layout::array::<T>(self.capacity).unwrap(),
             )
@@ -198,17 +209,19 @@ impl<T: Default> FromIterator<T> for Vec<T> {
     }
 }
 
-impl<T: Default> IntoIterator for Vec<T> {
+impl<T: Default, A: Allocator> IntoIterator for Vec<T, A> {
     type Item = T;
 
-    type IntoIter = VecIter<T>;
+    type IntoIter = VecIter<T, A>;
 
     fn into_iter(self) -> Self::IntoIter {
+        let this = ManuallyDrop::new(self);
         VecIter {
-            pointer: self.pointer,
+            pointer: this.pointer,
             index: 0,
-            length: self.length,
-            capacity: self.capacity,
+            length: this.length,
+            capacity: this.capacity,
+            allocator: unsafe { addr_of!(this.allocator).read() },
         }
     }
 }
@@ -245,14 +258,15 @@ impl<'a, T: 'a> DoubleEndedIterator for VecIterator<'a, T> {
     }
 }
 
-pub struct VecIter<T> {
+pub struct VecIter<T, A: Allocator = Global> {
     pointer: *mut T,
     index: usize,
     length: usize,
     capacity: usize,
+    allocator: A,
 }
 
-impl<T: Default> Iterator for VecIter<T> {
+impl<T: Default, A: Allocator> Iterator for VecIter<T, A> {
     type Item = T;
 
     fn next(&mut self) -> Option<Self::Item> {
@@ -272,10 +286,10 @@ impl<T: Default> Iterator for VecIter<T> {
     }
 }
 
-impl<T> Drop for VecIter<T> {
+impl<T, A: Allocator> Drop for VecIter<T, A> {
     fn drop(&mut self) {
         unsafe {
-            dealloc(
+            self.allocator.deallocate(
                 self.pointer.cast(),
                 Layout::array::<T>(self.capacity).unwrap(),
             )
@@ -3,12 +3,15 @@ use core::mem::{size_of, transmute};
 extern "C" {
     pub fn memset(des: *const u8, src: u8, len: usize);
     pub fn memcpy(des: *const u8, src: *const u8, len: usize);
+    pub fn memmove(des: *const u8, src: *const u8, len: usize);
     pub fn strlen(des: *const u8) -> usize;
 }
 
 pub trait PtrOptions<T> {
     unsafe fn kcopy_from(self, src: *const T, count: usize);
     unsafe fn kcopy_to(self, des: *const T, count: usize);
+    /// 与`kcopy_from`相同，但源与目标可以重叠。
+    unsafe fn kmove_from(self, src: *const T, count: usize);
 }
 
 impl<T> PtrOptions<T> for *mut T {
@@ -27,4 +30,12 @@ impl<T> PtrOptions<T> for *mut T {
             count * size_of::<T>(),
         );
     }
+
+    unsafe fn kmove_from(self, src: *const T, count: usize) {
+        memmove(
+            transmute(self.cast_const()),
+            transmute(src),
+            count * size_of::<T>(),
+        );
+    }
 }
@@ -0,0 +1,499 @@
+#include <libk/itree.h>
+
+#include <kernel/memm.h>
+
+#include <libk/math.h>
+
+void itree_pool_new(itree_pool_t *pool, usize tag)
+{
+    pool->tag = tag;
+    pool->free = nullptr;
+    pool->chunks = nullptr;
+    pool->allocated = 0;
+    pool->inuse = 0;
+}
+
+void itree_pool_destruct(itree_pool_t *pool)
+{
+    while (pool->chunks != nullptr)
+    {
+        itree_node_t *chunk = pool->chunks;
+        pool->chunks = chunk->parent;
+        memm_free(chunk);
+    }
+    itree_pool_new(pool, pool->tag);
+}
+
+static itree_node_t *itree_pool_get(itree_pool_t *pool)
+{
+    if (pool->free == nullptr)
+    {
+        itree_node_t *chunk = memm_kernel_allocate(sizeof(itree_node_t) * ITREE_POOL_CHUNK, pool->tag);
+        if (chunk == nullptr)
+            return nullptr;
+        chunk[0].parent = pool->chunks;
+        pool->chunks = chunk;
+        for (usize i = 1; i < ITREE_POOL_CHUNK; i++)
+        {
+            chunk[i].parent = pool->free;
+            pool->free = &chunk[i];
+        }
+        pool->allocated += ITREE_POOL_CHUNK - 1;
+    }
+    itree_node_t *node = pool->free;
+    pool->free = node->parent;
+    pool->inuse++;
+    return node;
+}
+
+static void itree_pool_put(itree_pool_t *pool, itree_node_t *node)
+{
+    node->parent = pool->free;
+    pool->free = node;
+    pool->inuse--;
+}
+
+void itree_new(itree_t *tree, usize start, usize end, itree_pool_t *pool)
+{
+    tree->root = nullptr;
+    tree->start = start;
+    tree->end = end;
+    tree->amount = 0;
+    tree->pool = pool;
+}
+
+// 根据子节点重新计算节点的附加信息
+static void itree_update(itree_node_t *node)
+{
+    node->min_start = node->start;
+    node->max_end = node->end;
+    node->max_gap = 0;
+    if (node->left != nullptr)
+    {
+        node->min_start = node->left->min_start;
+        node->max_gap = max(node->left->max_gap, node->start - node->left->max_end);
+    }
+    if (node->right != nullptr)
+    {
+        node->max_end = node->right->max_end;
+        node->max_gap = max(node->max_gap, node->right->max_gap);
+        node->max_gap = max(node->max_gap, node->right->min_start - node->end);
+    }
+}
+
+static void itree_update_path(itree_node_t *node)
+{
+    for (; node != nullptr; node = node->parent)
+        itree_update(node);
+}
+
+static inline bool itree_is_red(itree_node_t *node)
+{
+    return node != nullptr && node->red;
+}
+
+// 用new替换old在父节点中的位置
+static void itree_replace(itree_t *tree, itree_node_t *old, itree_node_t *new)
+{
+    if (old->parent == nullptr)
+        tree->root = new;
+    else if (old->parent->left == old)
+        old->parent->left = new;
+    else
+        old->parent->right = new;
+    if (new != nullptr)
+        new->parent = old->parent;
+}
+
+static void itree_rotate_left(itree_t *tree, itree_node_t *node)
+{
+    itree_node_t *right = node->right;
+    node->right = right->left;
+    if (right->left != nullptr)
+        right->left->parent = node;
+    itree_replace(tree, node, right);
+    right->left = node;
+    node->parent = right;
+    itree_update(node);
+    itree_update(right);
+}
+
+static void itree_rotate_right(itree_t *tree, itree_node_t *node)
+{
+    itree_node_t *left = node->left;
+    node->left = left->right;
+    if (left->right != nullptr)
+        left->right->parent = node;
+    itree_replace(tree, node, left);
+    left->right = node;
+    node->parent = left;
+    itree_update(node);
+    itree_update(left);
+}
+
+static void itree_insert_fixup(itree_t *tree, itree_node_t *node)
+{
+    while (itree_is_red(node->parent))
+    {
+        itree_node_t *parent = node->parent;
+        itree_node_t *grand = parent->parent;
+        if (parent == grand->left)
+        {
+            itree_node_t *uncle = grand->right;
+            if (itree_is_red(uncle))
+            {
+                parent->red = false;
+                uncle->red = false;
+                grand->red = true;
+                node = grand;
+                continue;
+            }
+            if (node == parent->right)
+            {
+                itree_rotate_left(tree, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->red = false;
+            grand->red = true;
+            itree_rotate_right(tree, grand);
+        }
+        else
+        {
+            itree_node_t *uncle = grand->left;
+            if (itree_is_red(uncle))
+            {
+                parent->red = false;
+                uncle->red = false;
+                grand->red = true;
+                node = grand;
+                continue;
+            }
+            if (node == parent->left)
+            {
+                itree_rotate_right(tree, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->red = false;
+            grand->red = true;
+            itree_rotate_left(tree, grand);
+        }
+    }
+    tree->root->red = false;
+}
+
+itree_node_t *itree_insert(itree_t *tree, usize start, usize end, void *data)
+{
+    if (start >= end || start < tree->start || end > tree->end)
+        return nullptr;
+
+    itree_node_t *parent = nullptr;
+    itree_node_t **link = &tree->root;
+    while (*link != nullptr)
+    {
+        parent = *link;
+        if (end <= parent->start)
+            link = &parent->left;
+        else if (start >= parent->end)
+            link = &parent->right;
+        else
+            return nullptr;
+    }
+
+    itree_node_t *node = itree_pool_get(tree->pool);
+    if (node == nullptr)
+        return nullptr;
+    node->start = start;
+    node->end = end;
+    node->data = data;
+    node->parent = parent;
+    node->left = nullptr;
+    node->right = nullptr;
+    node->red = true;
+    *link = node;
+    itree_update_path(node);
+    itree_insert_fixup(tree, node);
+    tree->amount++;
+    return node;
+}
+
+static void itree_remove_fixup(itree_t *tree, itree_node_t *node, itree_node_t *parent)
+{
+    while (node != tree->root && !itree_is_red(node))
+    {
+        if (node == parent->left)
+        {
+            itree_node_t *sibling = parent->right;
+            if (itree_is_red(sibling))
+            {
+                sibling->red = false;
+                parent->red = true;
+                itree_rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+            if (!itree_is_red(sibling->left) && !itree_is_red(sibling->right))
+            {
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (!itree_is_red(sibling->right))
+            {
+                sibling->left->red = false;
+                sibling->red = true;
+                itree_rotate_right(tree, sibling);
+                sibling = parent->right;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->right->red = false;
+            itree_rotate_left(tree, parent);
+        }
+        else
+        {
+            itree_node_t *sibling = parent->left;
+            if (itree_is_red(sibling))
+            {
+                sibling->red = false;
+                parent->red = true;
+                itree_rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+            if (!itree_is_red(sibling->left) && !itree_is_red(sibling->right))
+            {
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (!itree_is_red(sibling->left))
+            {
+                sibling->right->red = false;
+                sibling->red = true;
+                itree_rotate_left(tree, sibling);
+                sibling = parent->left;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->left->red = false;
+            itree_rotate_right(tree, parent);
+        }
+        node = tree->root;
+    }
+    if (node != nullptr)
+        node->red = false;
+}
+
+void itree_remove(itree_t *tree, itree_node_t *node)
+{
+    itree_node_t *child, *parent;
+    bool red = node->red;
+    if (node->left == nullptr)
+    {
+        child = node->right;
+        parent = node->parent;
+        itree_replace(tree, node, child);
+    }
+    else if (node->right == nullptr)
+    {
+        child = node->left;
+        parent = node->parent;
+        itree_replace(tree, node, child);
+    }
+    else
+    { // 用后继节点代替被移除的节点
+        itree_node_t *next = node->right;
+        while (next->left != nullptr)
+            next = next->left;
+        red = next->red;
+        child = next->right;
+        if (next->parent == node)
+            parent = next;
+        else
+        {
+            parent = next->parent;
+            itree_replace(tree, next, child);
+            next->right = node->right;
+            next->right->parent = next;
+        }
+        itree_replace(tree, node, next);
+        next->left = node->left;
+        next->left->parent = next;
+        next->red = node->red;
+    }
+    itree_update_path(parent);
+    if (!red)
+        itree_remove_fixup(tree, child, parent);
+    itree_pool_put(tree->pool, node);
+    tree->amount--;
+}
+
+itree_node_t *itree_first_overlap(itree_t *tree, usize start, usize end)
+{
+    itree_node_t *node = tree->root;
+    itree_node_t *res = nullptr;
+    while (node != nullptr)
+    {
+        if (node->end > start)
+        {
+            res = node;
+            node = node->left;
+        }
+        else
+            node = node->right;
+    }
+    if (res == nullptr || res->start >= end)
+        return nullptr;
+    return res;
+}
+
+itree_node_t *itree_find(itree_t *tree, usize address)
+{
+    itree_node_t *node = tree->root;
+    while (node != nullptr)
+    {
+        if (address < node->start)
+            node = node->left;
+        else if (address >= node->end)
+            node = node->right;
+        else
+            return node;
+    }
+    return nullptr;
+}
+
+itree_node_t *itree_first(itree_t *tree)
+{
+    itree_node_t *node = tree->root;
+    if (node == nullptr)
+        return nullptr;
+    while (node->left != nullptr)
+        node = node->left;
+    return node;
+}
+
+itree_node_t *itree_next(itree_node_t *node)
+{
+    if (node->right != nullptr)
+    {
+        node = node->right;
+        while (node->left != nullptr)
+            node = node->left;
+        return node;
+    }
+    while (node->parent != nullptr && node == node->parent->right)
+        node = node->parent;
+    return node->parent;
+}
+
+itree_node_t *itree_prev(itree_node_t *node)
+{
+    if (node->left != nullptr)
+    {
+        node = node->left;
+        while (node->right != nullptr)
+            node = node->right;
+        return node;
+    }
+    while (node->parent != nullptr && node == node->parent->left)
+        node = node->parent;
+    return node->parent;
+}
+
+itree_node_t *itree_split(itree_t *tree, itree_node_t *node, usize at)
+{
+    if (at <= node->start || at >= node->end)
+        return nullptr;
+    usize end = node->end;
+    node->end = at;
+    itree_update_path(node);
+    itree_node_t *res = itree_insert(tree, at, end, node->data);
+    if (res == nullptr)
+    {
+        node->end = end;
+        itree_update_path(node);
+    }
+    return res;
+}
+
+bool itree_merge(itree_t *tree, itree_node_t *node)
+{
+    itree_node_t *next = itree_next(node);
+    if (next == nullptr || next->start != node->end)
+        return false;
+    usize end = next->end;
+    itree_remove(tree, next);
+    node->end = end;
+    itree_update_path(node);
+    return true;
+}
+
+// 空隙[start,end)能否容纳按align对齐的size字节，能容纳时写入地址
+static bool itree_gap_fits(usize start, usize end, usize size, usize align, usize *address)
+{
+    usize res = start;
+    if (res % align != 0)
+    {
+        res += align - res % align;
+        if (res < start)
+            return false;
+    }
+    if (res > end || end - res < size)
+        return false;
+    *address = res;
+    return true;
+}
+
+// 子树node覆盖[start,end)，start与end是子树两侧相邻区间的边界或树的边界
+static bool itree_first_fit(
+    itree_node_t *node, usize start, usize end,
+    usize size, usize align, usize *address)
+{
+    if (node == nullptr)
+        return itree_gap_fits(start, end, size, align, address);
+    if (node->max_gap < size &&
+        node->min_start - start < size &&
+        end - node->max_end < size)
+        return false;
+    if (itree_first_fit(node->left, start, node->start, size, align, address))
+        return true;
+    return itree_first_fit(node->right, node->end, end, size, align, address);
+}
+
+// 在子树中寻找能容纳的最小空隙，best为已找到的最小空隙的长度，没有找到时为0，找到恰好容纳的空隙时返回true
+static bool itree_best_fit(
+    itree_node_t *node, usize start, usize end,
+    usize size, usize align, usize *address, usize *best)
+{
+    if (node == nullptr)
+    {
+        usize res;
+        if ((*best != 0 && end - start >= *best) || !itree_gap_fits(start, end, size, align, &res))
+            return false;
+        *address = res;
+        *best = end - start;
+        return *best == size;
+    }
+    if (node->max_gap < size &&
+        node->min_start - start < size &&
+        end - node->max_end < size)
+        return false;
+    if (itree_best_fit(node->left, start, node->start, size, align, address, best))
+        return true;
+    return itree_best_fit(node->right, node->end, end, size, align, address, best);
+}
+
+bool itree_find_gap(itree_t *tree, usize size, usize align, bool best_fit, usize *address)
+{
+    if (size == 0 || tree->end - tree->start < size)
+        return false;
+    if (align == 0)
+        align = 1;
+    if (!best_fit)
+        return itree_first_fit(tree->root, tree->start, tree->end, size, align, address);
+    usize best = 0;
+    itree_best_fit(tree->root, tree->start, tree->end, size, align, address, &best);
+    return best != 0;
+}
@@ -0,0 +1,168 @@
+#include <libk/lz4.h>
+
+#include <libk/string.h>
+#include <libk/math.h>
+
+// 最短匹配长度
+#define LZ4_MIN_MATCH 4
+// 块的最后5字节总是字面量
+#define LZ4_LAST_LITERALS 5
+// 最后一个匹配必须在块结束前12字节之前开始
+#define LZ4_MF_LIMIT 12
+
+static inline u32 lz4_read32(u8 *p)
+{
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static inline u32 lz4_hash(u32 sequence)
+{
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+// 写入长度超过15的部分，返回写入后的位置
+static inline u8 *lz4_write_length(u8 *dst, usize length)
+{
+    while (length >= 255)
+    {
+        *dst++ = 255;
+        length -= 255;
+    }
+    *dst++ = (u8)length;
+    return dst;
+}
+
+// 写入一个序列，match为0时是只有字面量的最后一个序列，空间不足时返回nullptr
+static u8 *lz4_write_sequence(
+    u8 *dst, u8 *dst_end,
+    u8 *literal, usize literal_length,
+    usize offset, usize match)
+{
+    usize match_length = match == 0 ? 0 : match - LZ4_MIN_MATCH;
+    usize need = 1 + literal_length + literal_length / 255 + 1;
+    if (match != 0)
+        need += 2 + match_length / 255 + 1;
+    if (need > (usize)(dst_end - dst))
+        return nullptr;
+
+    u8 *token = dst++;
+    *token = (u8)(min(literal_length, 15) << 4);
+    if (literal_length >= 15)
+        dst = lz4_write_length(dst, literal_length - 15);
+    memcpy(dst, literal, literal_length);
+    dst += literal_length;
+    if (match == 0)
+        return dst;
+
+    *dst++ = (u8)offset;
+    *dst++ = (u8)(offset >> 8);
+    *token |= (u8)min(match_length, 15);
+    if (match_length >= 15)
+        dst = lz4_write_length(dst, match_length - 15);
+    return dst;
+}
+
+usize lz4_compress(void *source, usize size, void *dest, usize capacity, u16 *table)
+{
+    if (size > LZ4_INPUT_MAX)
+        return 0;
+    u8 *src = source;
+    u8 *dst = dest;
+    u8 *dst_end = dst + capacity;
+    usize anchor = 0;
+
+    if (size >= LZ4_MF_LIMIT)
+    {
+        memset(table, 0, LZ4_HASH_SIZE * sizeof(u16));
+        usize limit = size - LZ4_MF_LIMIT;
+        usize match_limit = size - LZ4_LAST_LITERALS;
+        usize pos = 0;
+        while (pos <= limit)
+        {
+            u32 sequence = lz4_read32(src + pos);
+            u32 hash = lz4_hash(sequence);
+            usize ref = table[hash];
+            table[hash] = (u16)pos;
+            if (ref >= pos || lz4_read32(src + ref) != sequence)
+            {
+                pos++;
+                continue;
+            }
+
+            usize length = LZ4_MIN_MATCH;
+            while (pos + length < match_limit && src[ref + length] == src[pos + length])
+                length++;
+            // 向前扩展匹配
+            while (pos > anchor && ref > 0 && src[pos - 1] == src[ref - 1])
+            {
+                pos--;
+                ref--;
+                length++;
+            }
+            dst = lz4_write_sequence(dst, dst_end, src + anchor, pos - anchor, pos - ref, length);
+            if (dst == nullptr)
+                return 0;
+            pos += length;
+            anchor = pos;
+        }
+    }
+
+    dst = lz4_write_sequence(dst, dst_end, src + anchor, size - anchor, 0, 0);
+    if (dst == nullptr)
+        return 0;
+    return dst - (u8 *)dest;
+}
+
+// 读取长度超过15的部分，输入结束时返回false
+static inline bool lz4_read_length(u8 **src, u8 *src_end, usize *length)
+{
+    u8 byte;
+    do
+    {
+        if (*src >= src_end)
+            return false;
+        byte = *(*src)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool lz4_decompress(void *source, usize size, void *dest, usize dest_size)
+{
+    u8 *src = source;
+    u8 *src_end = src + size;
+    u8 *dst = dest;
+    u8 *dst_end = dst + dest_size;
+    while (src < src_end)
+    {
+        u8 token = *src++;
+        usize literal_length = token >> 4;
+        if (literal_length == 15 && !lz4_read_length(&src, src_end, &literal_length))
+            return false;
+        if (literal_length > (usize)(src_end - src) || literal_length > (usize)(dst_end - dst))
+            return false;
+        memcpy(dst, src, literal_length);
+        dst += literal_length;
+        src += literal_length;
+        if (src == src_end)
+            break;
+
+        if (src_end - src < 2)
+            return false;
+        usize offset = (usize)src[0] | ((usize)src[1] << 8);
+        src += 2;
+        if (offset == 0 || offset > (usize)(dst - (u8 *)dest))
+            return false;
+        usize match_length = token & 15;
+        if (match_length == 15 && !lz4_read_length(&src, src_end, &match_length))
+            return false;
+        match_length += LZ4_MIN_MATCH;
+        if (match_length > (usize)(dst_end - dst))
+            return false;
+        // 匹配可以与正在写入的部分重叠，逐字节复制
+        u8 *ref = dst - offset;
+        while (match_length-- != 0)
+            *dst++ = *ref++;
+    }
+    return dst == dst_end;
+}
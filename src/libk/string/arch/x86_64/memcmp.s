@@ -0,0 +1,44 @@
+    section .text
+
+    global memcmp
+    global bcmp
+; int memcmp(void *__s1, void *__s2, usize len)
+;
+; 按8字节比较，不相等时找出第一个不同的字节。`bcmp`是同一个函数，rust编译器会生成对它的调用。
+memcmp:
+bcmp:
+    endbr64
+.loop8:
+    cmp rdx, 8
+    jb .loop1
+    mov rax, [rdi]
+    mov rcx, [rsi]
+    cmp rax, rcx
+    jne .diff
+    add rdi, 8
+    add rsi, 8
+    sub rdx, 8
+    jmp .loop8
+.diff:
+    ; 小端序中最低的不同位所在的字节就是第一个不同的字节
+    xor rax, rcx
+    bsf rax, rax
+    shr eax, 3
+    movzx ecx, byte [rsi + rax]
+    movzx eax, byte [rdi + rax]
+    sub eax, ecx
+    ret
+.loop1:
+    xor eax, eax
+    test rdx, rdx
+    jz .done
+    movzx eax, byte [rdi]
+    movzx ecx, byte [rsi]
+    sub eax, ecx
+    jnz .done
+    inc rdi
+    inc rsi
+    dec rdx
+    jmp .loop1
+.done:
+    ret
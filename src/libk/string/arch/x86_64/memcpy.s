@@ -1,17 +1,178 @@
     section .text
 
+    extern string_memcpy_entry
+    extern string_rep_threshold
+    extern string_nt_threshold
+
     global memcpy
-; void memcpy(void *__dest, restrict void *__src, usize len)
+; void *memcpy(void *__dest, restrict void *__src, usize len)
+;
+; 不超过16字节时用两次可以重叠的读取与写入完成，所有读取在写入之前，`memmove`也使用这条路径。
+; 更长的复制跳转到`string_init`选择的`string_memcpy_entry`。
 memcpy:
     endbr64
-    sub rsp, 8
-    mov [rsp], rcx
+    mov rax, rdi
+    cmp rdx, 16
+    ja .large
+
+    cmp edx, 8
+    jb .lt8
+    mov rcx, [rsi]
+    mov r8, [rsi + rdx - 8]
+    mov [rdi], rcx
+    mov [rdi + rdx - 8], r8
+    ret
+.lt8:
+    cmp edx, 4
+    jb .lt4
+    mov ecx, [rsi]
+    mov r8d, [rsi + rdx - 4]
+    mov [rdi], ecx
+    mov [rdi + rdx - 4], r8d
+    ret
+.lt4:
+    test edx, edx
+    jz .done
+    ; 1~3字节：第一个、中间与最后一个字节
+    mov r9, rdx
+    shr r9, 1
+    movzx ecx, byte [rsi]
+    movzx r8d, byte [rsi + rdx - 1]
+    movzx r10d, byte [rsi + r9]
+    mov [rdi], cl
+    mov [rdi + rdx - 1], r8b
+    mov [rdi + r9], r10b
+.done:
+    ret
+.large:
+    jmp qword [rel string_memcpy_entry]
 
+    global memcpy_qword
+; 8字节通用寄存器循环，len > 16
+memcpy_qword:
+    cmp rdx, [rel string_nt_threshold]
+    jae memcpy_nt
+.body:
+    ; 先复制开头8字节，再把目标地址对齐到8字节
+    mov rcx, [rsi]
+    mov [rdi], rcx
+    mov rcx, rdi
+    neg rcx
+    and ecx, 7
+    add rdi, rcx
+    add rsi, rcx
+    sub rdx, rcx
+.loop32:
+    cmp rdx, 32
+    jb .loop8
+    mov rcx, [rsi]
+    mov r8, [rsi + 8]
+    mov r9, [rsi + 16]
+    mov r10, [rsi + 24]
+    mov [rdi], rcx
+    mov [rdi + 8], r8
+    mov [rdi + 16], r9
+    mov [rdi + 24], r10
+    add rsi, 32
+    add rdi, 32
+    sub rdx, 32
+    jmp .loop32
+.loop8:
+    cmp rdx, 8
+    jb .tail
+    mov rcx, [rsi]
+    mov [rdi], rcx
+    add rsi, 8
+    add rdi, 8
+    sub rdx, 8
+    jmp .loop8
+.tail:
+    ; 最后不足8字节的部分与已复制的部分重叠
+    mov rcx, [rsi + rdx - 8]
+    mov [rdi + rdx - 8], rcx
+    ret
+
+    global memcpy_erms
+; 处理器支持ERMS或FSRM时，不小于`string_rep_threshold`字节的复制使用`rep movsb`，len > 16
+memcpy_erms:
+    cmp rdx, [rel string_nt_threshold]
+    jae memcpy_nt
+    cmp rdx, [rel string_rep_threshold]
+    jb memcpy_qword.body
     cld
     mov rcx, rdx
     rep movsb
+    ret
 
-    mov rcx, [rsp]
-    add rsp, 8
-
+    global memcpy_nt
+; 超过缓存大小的复制使用非临时存储，不替换缓存中的数据，len >= 64
+memcpy_nt:
+    ; 开头64字节使用普通写入，之后目标地址按64字节对齐，每次写满一个缓存行
+    mov rcx, [rsi]
+    mov r8, [rsi + 8]
+    mov r9, [rsi + 16]
+    mov r10, [rsi + 24]
+    mov [rdi], rcx
+    mov [rdi + 8], r8
+    mov [rdi + 16], r9
+    mov [rdi + 24], r10
+    mov rcx, [rsi + 32]
+    mov r8, [rsi + 40]
+    mov r9, [rsi + 48]
+    mov r10, [rsi + 56]
+    mov [rdi + 32], rcx
+    mov [rdi + 40], r8
+    mov [rdi + 48], r9
+    mov [rdi + 56], r10
+    mov rcx, rdi
+    neg rcx
+    and ecx, 63
+    add rdi, rcx
+    add rsi, rcx
+    sub rdx, rcx
+.loop:
+    cmp rdx, 64
+    jb .tail
+    mov rcx, [rsi]
+    mov r8, [rsi + 8]
+    mov r9, [rsi + 16]
+    mov r10, [rsi + 24]
+    movnti [rdi], rcx
+    movnti [rdi + 8], r8
+    movnti [rdi + 16], r9
+    movnti [rdi + 24], r10
+    mov rcx, [rsi + 32]
+    mov r8, [rsi + 40]
+    mov r9, [rsi + 48]
+    mov r10, [rsi + 56]
+    movnti [rdi + 32], rcx
+    movnti [rdi + 40], r8
+    movnti [rdi + 48], r9
+    movnti [rdi + 56], r10
+    add rsi, 64
+    add rdi, 64
+    sub rdx, 64
+    jmp .loop
+.tail:
+    ; 非临时存储是弱有序的，返回前保证它们对其它访问可见
+    sfence
+    ; 最后不足64字节的部分与已复制的部分重叠
+    lea rsi, [rsi + rdx - 64]
+    lea rdi, [rdi + rdx - 64]
+    mov rcx, [rsi]
+    mov r8, [rsi + 8]
+    mov r9, [rsi + 16]
+    mov r10, [rsi + 24]
+    mov [rdi], rcx
+    mov [rdi + 8], r8
+    mov [rdi + 16], r9
+    mov [rdi + 24], r10
+    mov rcx, [rsi + 32]
+    mov r8, [rsi + 40]
+    mov r9, [rsi + 48]
+    mov r10, [rsi + 56]
+    mov [rdi + 32], rcx
+    mov [rdi + 40], r8
+    mov [rdi + 48], r9
+    mov [rdi + 56], r10
     ret
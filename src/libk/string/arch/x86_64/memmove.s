@@ -0,0 +1,96 @@
+    section .text
+
+    extern memcpy
+
+    global memmove
+; void *memmove(void *__dest, void *__src, usize len)
+;
+; 不重叠或不超过16字节时使用`memcpy`。
+; 目标在源之前时从前向后复制，否则从后向前复制，每组数据都先全部读取再写入。
+memmove:
+    endbr64
+    cmp rdx, 16
+    jbe memcpy
+    mov rax, rdi
+    sub rax, rsi
+    cmp rax, rdx
+    jb .backward
+    mov rax, rsi
+    sub rax, rdi
+    cmp rax, rdx
+    jae memcpy
+
+    mov rax, rdi
+.forward32:
+    cmp rdx, 32
+    jb .forward8
+    mov rcx, [rsi]
+    mov r8, [rsi + 8]
+    mov r9, [rsi + 16]
+    mov r10, [rsi + 24]
+    mov [rdi], rcx
+    mov [rdi + 8], r8
+    mov [rdi + 16], r9
+    mov [rdi + 24], r10
+    add rsi, 32
+    add rdi, 32
+    sub rdx, 32
+    jmp .forward32
+.forward8:
+    cmp rdx, 8
+    jb .forward1
+    mov rcx, [rsi]
+    mov [rdi], rcx
+    add rsi, 8
+    add rdi, 8
+    sub rdx, 8
+    jmp .forward8
+.forward1:
+    test rdx, rdx
+    jz .done
+    mov cl, [rsi]
+    mov [rdi], cl
+    inc rsi
+    inc rdi
+    dec rdx
+    jmp .forward1
+
+.backward:
+    mov rax, rdi
+    add rsi, rdx
+    add rdi, rdx
+.backward32:
+    cmp rdx, 32
+    jb .backward8
+    mov rcx, [rsi - 8]
+    mov r8, [rsi - 16]
+    mov r9, [rsi - 24]
+    mov r10, [rsi - 32]
+    mov [rdi - 8], rcx
+    mov [rdi - 16], r8
+    mov [rdi - 24], r9
+    mov [rdi - 32], r10
+    sub rsi, 32
+    sub rdi, 32
+    sub rdx, 32
+    jmp .backward32
+.backward8:
+    cmp rdx, 8
+    jb .backward1
+    mov rcx, [rsi - 8]
+    mov [rdi - 8], rcx
+    sub rsi, 8
+    sub rdi, 8
+    sub rdx, 8
+    jmp .backward8
+.backward1:
+    test rdx, rdx
+    jz .done
+    mov cl, [rsi - 1]
+    mov [rdi - 1], cl
+    dec rsi
+    dec rdi
+    dec rdx
+    jmp .backward1
+.done:
+    ret
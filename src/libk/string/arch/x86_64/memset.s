@@ -1,21 +1,137 @@
     section .text
 
+    extern string_memset_entry
+    extern string_rep_threshold
+    extern string_nt_threshold
+
     global memset
-; void memset(void *__dest, u8 __src, usize len)
+; void *memset(void *__dest, u8 __src, usize len)
+;
+; 把`__src`扩展为8字节的`rsi`，不超过16字节时用两次可以重叠的写入完成。
+; 更长的填充跳转到`string_init`选择的`string_memset_entry`。
 memset:
     endbr64
+    mov rax, rdi
+    movzx esi, sil
+    mov r8, 0x0101010101010101
+    imul rsi, r8
+    cmp rdx, 16
+    ja .large
+
+    cmp edx, 8
+    jb .lt8
+    mov [rdi], rsi
+    mov [rdi + rdx - 8], rsi
+    ret
+.lt8:
+    cmp edx, 4
+    jb .lt4
+    mov [rdi], esi
+    mov [rdi + rdx - 4], esi
+    ret
+.lt4:
+    test edx, edx
+    jz .done
+    mov [rdi], sil
+    mov [rdi + rdx - 1], sil
+    cmp edx, 3
+    jb .done
+    mov [rdi + 1], sil
+.done:
+    ret
+.large:
+    jmp qword [rel string_memset_entry]
 
-    sub rsp, 0x10
-    mov [rsp], rax
-    mov [rsp + 8], rcx
+    global memset_qword
+; 8字节通用寄存器循环，len > 16
+memset_qword:
+    cmp rdx, [rel string_nt_threshold]
+    jae memset_nt
+.body:
+    ; 开头与结尾的8字节先写入，再把目标地址对齐到8字节
+    mov [rdi], rsi
+    mov [rdi + rdx - 8], rsi
+    mov rcx, rdi
+    neg rcx
+    and ecx, 7
+    add rdi, rcx
+    sub rdx, rcx
+.loop32:
+    cmp rdx, 32
+    jb .loop8
+    mov [rdi], rsi
+    mov [rdi + 8], rsi
+    mov [rdi + 16], rsi
+    mov [rdi + 24], rsi
+    add rdi, 32
+    sub rdx, 32
+    jmp .loop32
+.loop8:
+    cmp rdx, 8
+    jb .done
+    mov [rdi], rsi
+    add rdi, 8
+    sub rdx, 8
+    jmp .loop8
+.done:
+    ret
 
+    global memset_erms
+; 处理器支持ERMS或FSRM时，不小于`string_rep_threshold`字节的填充使用`rep stosb`，len > 16
+memset_erms:
+    cmp rdx, [rel string_nt_threshold]
+    jae memset_nt
+    cmp rdx, [rel string_rep_threshold]
+    jb memset_qword.body
     cld
-    mov rax, rsi
+    mov r11, rdi
+    mov eax, esi
     mov rcx, rdx
     rep stosb
+    mov rax, r11
+    ret
 
-    mov rax, [rsp]
-    mov rcx, [rsp + 8]
-    add rsp, 0x10
-
+    global memset_nt
+; 超过缓存大小的填充使用非临时存储，len >= 64
+memset_nt:
+    ; 开头与结尾的64字节使用普通写入，中间按缓存行对齐
+    mov [rdi], rsi
+    mov [rdi + 8], rsi
+    mov [rdi + 16], rsi
+    mov [rdi + 24], rsi
+    mov [rdi + 32], rsi
+    mov [rdi + 40], rsi
+    mov [rdi + 48], rsi
+    mov [rdi + 56], rsi
+    lea rcx, [rdi + rdx - 64]
+    mov [rcx], rsi
+    mov [rcx + 8], rsi
+    mov [rcx + 16], rsi
+    mov [rcx + 24], rsi
+    mov [rcx + 32], rsi
+    mov [rcx + 40], rsi
+    mov [rcx + 48], rsi
+    mov [rcx + 56], rsi
+    mov rcx, rdi
+    neg rcx
+    and ecx, 63
+    add rdi, rcx
+    sub rdx, rcx
+.loop:
+    cmp rdx, 64
+    jb .done
+    movnti [rdi], rsi
+    movnti [rdi + 8], rsi
+    movnti [rdi + 16], rsi
+    movnti [rdi + 24], rsi
+    movnti [rdi + 32], rsi
+    movnti [rdi + 40], rsi
+    movnti [rdi + 48], rsi
+    movnti [rdi + 56], rsi
+    add rdi, 64
+    sub rdx, 64
+    jmp .loop
+.done:
+    ; 非临时存储是弱有序的，返回前保证它们对其它访问可见
+    sfence
     ret
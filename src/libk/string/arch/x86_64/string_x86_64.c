@@ -0,0 +1,81 @@
+#include <libk/string.h>
+#include <kernel/kernel.h>
+
+extern void memcpy_qword();
+extern void memcpy_erms();
+extern void memset_qword();
+extern void memset_erms();
+
+// 由memcpy.s与memset.s读取
+void *string_memcpy_entry = memcpy_qword;
+void *string_memset_entry = memset_qword;
+usize string_rep_threshold = ~(usize)0;
+usize string_nt_threshold = ~(usize)0;
+
+// 最后一级数据缓存或统一缓存的字节数，无法取得时返回0
+static usize string_cache_size()
+{
+    u32 regs[4];
+    kernel_cpuid(0, 0, regs);
+    usize size = 0;
+    if (regs[0] >= 4)
+    {
+        // CPUID.(EAX=04H,ECX=n)，每个子叶描述一个缓存，类型为0时结束
+        usize level = 0;
+        for (u32 i = 0;; i++)
+        {
+            kernel_cpuid(4, i, regs);
+            u32 type = regs[0] & 0x1f;
+            if (type == 0)
+                break;
+            if (type == 2) // 指令缓存
+                continue;
+            usize this_level = (regs[0] >> 5) & 7;
+            if (this_level < level)
+                continue;
+            level = this_level;
+            size = (usize)((regs[1] >> 22) + 1)             // ways
+                   * (((regs[1] >> 12) & 0x3ff) + 1)       // partitions
+                   * ((regs[1] & 0xfff) + 1)               // line size
+                   * ((usize)regs[2] + 1);                 // sets
+        }
+    }
+    if (size != 0)
+        return size;
+    kernel_cpuid(0x80000000, 0, regs);
+    if (regs[0] >= 0x80000006)
+    {
+        kernel_cpuid(0x80000006, 0, regs);
+        size = (usize)(regs[3] >> 18) * 512 * 1024; // L3
+        if (size == 0)
+            size = (usize)(regs[2] >> 16) * 1024; // L2
+    }
+    return size;
+}
+
+void string_init()
+{
+    u32 regs[4];
+    bool erms = false, fsrm = false;
+    kernel_cpuid(0, 0, regs);
+    if (regs[0] >= 7)
+    {
+        kernel_cpuid(7, 0, regs);
+        erms = (regs[1] & ((u32)1 << 9)) != 0; // CPUID.(EAX=07H,ECX=0):EBX.ERMS
+        fsrm = (regs[3] & ((u32)1 << 4)) != 0; // CPUID.(EAX=07H,ECX=0):EDX.FSRM
+    }
+
+    usize cache = string_cache_size();
+    if (cache != 0)
+    {
+        cache = cache / 4 * 3;
+        string_nt_threshold = cache > STRING_NT_MIN ? cache : STRING_NT_MIN;
+    }
+
+    if (erms || fsrm)
+    {
+        string_rep_threshold = fsrm ? 0 : STRING_ERMS_THRESHOLD;
+        string_memcpy_entry = memcpy_erms;
+        string_memset_entry = memset_erms;
+    }
+}
@@ -2,18 +2,36 @@
 
     global strlen
 ; usize strlen(char *)
+;
+; 对齐到8字节后每次检查8字节，对齐的读取不会跨越页的边界。
 strlen:
-    push rcx
-    
-    cld
-    mov al, 0
-    xor rcx, rcx
-    dec rcx
-    repne scasb
-
-    not rcx
-    dec rcx
-
-    mov rax, rcx
-    pop rcx
+    endbr64
+    mov rax, rdi
+.align:
+    test al, 7
+    jz .words
+    cmp byte [rax], 0
+    je .done
+    inc rax
+    jmp .align
+.words:
+    mov r8, 0x0101010101010101
+    mov r9, 0x8080808080808080
+.loop:
+    ; (x - 0x01..01) & ~x & 0x80..80中最低的置位在第一个0字节中
+    mov rcx, [rax]
+    mov rdx, rcx
+    sub rcx, r8
+    not rdx
+    and rcx, rdx
+    and rcx, r9
+    jnz .found
+    add rax, 8
+    jmp .loop
+.found:
+    bsf rcx, rcx
+    shr ecx, 3
+    add rax, rcx
+.done:
+    sub rax, rdi
     ret